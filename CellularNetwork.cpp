@@ -1,56 +1,868 @@
 // CellularNetwork.cpp
 #include "CellularNetwork.h"
 #include "basicIO.h"
+#include "ResultWriter.h"
+#include "ScenarioCache.h"
+#include "CoreAllocator.h"
+#include "StatsServer.h"
+#include <thread>
+#include <chrono>
+#include <algorithm>
 #include <cstdlib>
 #include <cstring>
+#include <cmath>
+#include <exception>
 
 // ============================================================================
 // GLOBAL I/O (basicIO implemented in basicIO.cpp)
 extern basicIO io;
 
 // ============================================================================
-// CellTower — default implementations for displays & cores calculation
+// TowerConfig — project specification defaults and validation
 // ============================================================================
 
+TowerConfig TowerConfig::defaults(GenerationType gen) {
+    //                 total  chan  users antennas extra  extraCh extraUsers
+    switch (gen) {
+        case GEN_2G: return {1000, 200, 16, 1,  0,     1000, 0};
+        case GEN_3G: return {1000, 200, 32, 1,  0,     1000, 0};
+        case GEN_4G: return {1000, 10,  30, 4,  0,     1000, 0};
+        case GEN_5G: return {1000, 10,  30, 16, 10000, 1000, 30};
+    }
+    throw InvalidConfigurationException("unknown generation");
+}
+
+void TowerConfig::validate() const {
+    if (channelBandwidth <= 0) throw InvalidConfigurationException("channel bandwidth invalid");
+    if (totalBandwidth < channelBandwidth) throw InvalidConfigurationException("total bandwidth smaller than one channel");
+    if (usersPerChannel < 1) throw InvalidConfigurationException("users per channel must be positive");
+    if (numAntennas < 1) throw InvalidConfigurationException("antenna count must be positive");
+    if (extraBandwidth < 0) throw InvalidConfigurationException("extra bandwidth invalid");
+    if (extraBandwidth > 0) {
+        if (extraChannelBandwidth <= 0) throw InvalidConfigurationException("extra channel bandwidth invalid");
+        if (extraUsersPerChannel < 1) throw InvalidConfigurationException("extra users per channel must be positive");
+    }
+}
+
+// ============================================================================
+// Traffic profiles and mix
+// ============================================================================
+
+void TrafficProfile::validate() const {
+    if (messages < 0 || overheadPer100Messages < 0) {
+        throw InvalidConfigurationException("traffic profile values must not be negative");
+    }
+    if (overheadPer100Messages >= 100) {
+        throw InvalidConfigurationException("traffic profile overhead must be below 100");
+    }
+    if (loadUnits() > UINT32_MAX) {
+        throw InvalidConfigurationException("traffic profile load per user too large");
+    }
+}
+
+TrafficProfile TrafficProfile::defaults(GenerationType gen, TrafficClass cls) {
+    const int nominal = defaultMessagesPerUser(gen);
+    switch (cls) {
+        case TRAFFIC_DATA:  return {nominal, 0};
+        case TRAFFIC_VOICE: return {gen == GEN_2G ? User2G(0).getVoiceMessages() : nominal, 0};
+        case TRAFFIC_VIDEO: return {nominal * 4, 10};
+        case TRAFFIC_IOT:   return {nominal / 5 > 0 ? nominal / 5 : 1, 50};
+        default: break;
+    }
+    throw InvalidConfigurationException("unknown traffic class");
+}
+
+TrafficClass TrafficMix::classForId(long long deviceId) const {
+    int bucket = (int)(deviceId % 100);
+    int upper = 0;
+    for (int cls = 0; cls < TRAFFIC_CLASS_COUNT; ++cls) {
+        upper += percent[cls];
+        if (bucket < upper) return static_cast<TrafficClass>(cls);
+    }
+    return TRAFFIC_DATA;
+}
+
+// IDs in [0, n) whose bucket (id % 100) lies in [lo, hi)
+static long long idsInBuckets(long long n, int lo, int hi) {
+    long long partial = n % 100 - lo;
+    if (partial < 0) partial = 0;
+    if (partial > hi - lo) partial = hi - lo;
+    return (n / 100) * (hi - lo) + partial;
+}
+
+long long TrafficMix::countInRange(TrafficClass cls, long long firstId, long long count) const {
+    int lo = 0;
+    for (int c = 0; c < cls; ++c) lo += percent[c];
+    int hi = lo + percent[cls];
+    return idsInBuckets(firstId + count, lo, hi) - idsInBuckets(firstId, lo, hi);
+}
+
+void TrafficMix::validate() const {
+    int sum = 0;
+    for (int cls = 0; cls < TRAFFIC_CLASS_COUNT; ++cls) {
+        if (percent[cls] < 0) throw InvalidConfigurationException("traffic share must not be negative");
+        sum += percent[cls];
+    }
+    if (sum != 100) throw InvalidConfigurationException("traffic shares must add up to 100");
+}
+
+// ============================================================================
+// CellTower — population, factory, displays & cores calculation
+// ============================================================================
+
+std::shared_ptr<CellTower> CellTower::create(GenerationType gen, const TowerConfig& config) {
+    switch (gen) {
+        case GEN_2G: return std::make_shared<Tower2G>(config);
+        case GEN_3G: return std::make_shared<Tower3G>(config);
+        case GEN_4G: return std::make_shared<Tower4G>(config);
+        case GEN_5G: return std::make_shared<Tower5G>(config);
+    }
+    throw InvalidConfigurationException("unknown generation");
+}
+
+void CellTower::resetOccupancy() {
+    std::vector<int> perChannel;
+    for (int band = 0; band < getNumBands(); ++band) perChannel.push_back(getUsersPerChannelInBand(band));
+    int widest = numChannels > numExtraChannels ? numChannels : numExtraChannels;
+    occupancy.reset(getNumBands(), numAntennas, widest, perChannel);
+
+    forEachUserRun([this](long long, long long run, int channel, int antenna, int band, const UserDevice*) {
+        if (occupancy.contains(band, antenna, channel)) occupancy.add(band, antenna, channel, (int)run);
+    });
+}
+
+void CellTower::setNumAntennas(int antennas) {
+    if (activeUsers > 0 || nextLayoutPosition > 0) {
+        throw InvalidConfigurationException("antennas must be set before the tower is populated");
+    }
+    numAntennas = antennas < 1 ? 1 : antennas;
+    resetOccupancy();
+}
+
+void CellTower::layoutCell(long long position, int& band, int& antenna, int& channel) const {
+    band = 0;
+    long long bandSize = (long long)numAntennas * numChannels * usersPerChannel;
+    if (position >= bandSize) {
+        position -= bandSize;
+        band = 1;
+    }
+    const long long perChannel = getUsersPerChannelInBand(band);
+    const long long perAntenna = (long long)getChannelsInBand(band) * perChannel;
+    antenna = (int)(position / perAntenna);
+    channel = (int)((position % perAntenna) / perChannel);
+}
+
+long long CellTower::layoutRun(long long position, int& band, int& antenna, int& channel) const {
+    layoutCell(position, band, antenna, channel);
+    long long bandStart = band == 0 ? 0 : (long long)numAntennas * numChannels * usersPerChannel;
+    long long perChannel = getUsersPerChannelInBand(band);
+    return perChannel - (position - bandStart) % perChannel;
+}
+
+CellTower::~CellTower() {
+    // users that outlive the tower must not count into it any more
+    for (long long slot = 0; slot < users.size(); ++slot) {
+        const auto& user = users.get(slot);
+        if (user) user->setDeactivationCounter(nullptr);
+    }
+}
+
+bool CellTower::hasRoom() {
+    if (activeUsers >= getTotalCapacity()) releaseInactiveSlots();
+    return activeUsers < getTotalCapacity();
+}
+
+long long CellTower::addUser(std::shared_ptr<UserDevice> user) {
+    if (!user) throw NetworkException("null user");
+    if (!hasRoom()) {
+        throw CapacityExceededException();
+    }
+    const int band = user->getFrequencyBand();
+    if (!occupancy.contains(band, user->getAntennaId(), user->getChannelId())) {
+        throw InvalidConfigurationException("user outside tower channel layout");
+    }
+
+    long long slot = placeUser(user);
+    occupancy.add(band, user->getAntennaId(), user->getChannelId());
+    ++activeUsers;
+    invalidateResourceFactor();
+    if (user->getDeviceId() >= nextDeviceId) nextDeviceId = user->getDeviceId() + 1;
+    return slot;
+}
+
+// users placed between updates of the live counters (see setStats)
+static const long long POPULATION_STATS_BATCH = 65536;
+
+void CellTower::populate(long long targetUsers) {
+    releaseInactiveSlots();
+    long long added = 0;   // one by one below; ranges report their own progress
+    long long totalCapacity = getTotalCapacity();
+    if (targetUsers < 0 || targetUsers > totalCapacity) targetUsers = totalCapacity;
+    if (activeUsers >= targetUsers) return;
+    // Only vacancies grow the store one user at a time (layout cells placed
+    // singly go into free slots); ranges, lazy or not, size it themselves.
+    const long long vacancyUsers = std::min((long long)vacancies.size(), targetUsers - activeUsers);
+    if (vacancyUsers > (long long)freeSlots.size()) {
+        users.reserve(users.size() + vacancyUsers - (long long)freeSlots.size());
+    }
+
+    while (activeUsers < targetUsers) {
+        int band, antenna, channel;
+        if (!vacancies.empty()) {
+            band = vacancies.back().band;
+            antenna = vacancies.back().antenna;
+            channel = vacancies.back().channel;
+            vacancies.pop_back();
+        } else if (lazyPopulation && nextLayoutPosition < totalCapacity) {
+            long long count = targetUsers - activeUsers;
+            if (count > totalCapacity - nextLayoutPosition) count = totalCapacity - nextLayoutPosition;
+            recordLazyRange(count);
+            continue;
+        } else if (nextLayoutPosition < totalCapacity && freeSlots.empty()) {
+            long long count = targetUsers - activeUsers;
+            if (count > totalCapacity - nextLayoutPosition) count = totalCapacity - nextLayoutPosition;
+            populateRange(count);
+            continue;
+        } else if (nextLayoutPosition < totalCapacity) {
+            layoutCell(nextLayoutPosition++, band, antenna, channel);
+        } else {
+            break;  // remaining room was taken by users added outside populate()
+        }
+        addUser(createPopulatedUser(nextDeviceId, channel, antenna, band));
+        if (stats && ++added == POPULATION_STATS_BATCH) {
+            stats->recordPopulated(added);
+            added = 0;
+        }
+    }
+    if (stats) stats->recordPopulated(added);
+}
+
+// below this many users per worker, threads cost more than they save
+static const long long MIN_USERS_PER_POPULATION_WORKER = 16384;
+
+void CellTower::populateRange(long long count) {
+    if (count <= 0) return;
+    const long long firstSlot = users.size();
+    const long long firstPosition = nextLayoutPosition;
+    const long long firstId = nextDeviceId;
+    users.resize(firstSlot + count);
+    slotLoad.resize((size_t)(firstSlot + count));
+
+    long long workers = populationThreads > 0 ? populationThreads : (long long)std::thread::hardware_concurrency();
+    if (workers > count / MIN_USERS_PER_POPULATION_WORKER) workers = count / MIN_USERS_PER_POPULATION_WORKER;
+    if (workers < 1) workers = 1;
+
+    // slice boundaries (offsets into the range), moved forward to the next channel start
+    std::vector<long long> bounds(1, 0);
+    for (long long w = 1; w < workers; ++w) {
+        long long offset = count * w / workers;
+        int band, antenna, channel;
+        long long run = layoutRun(firstPosition + offset, band, antenna, channel);
+        if (run != getUsersPerChannelInBand(band)) offset += run;
+        if (offset > bounds.back() && offset < count) bounds.push_back(offset);
+    }
+    bounds.push_back(count);
+
+    // each slice writes only its own slots; the live counters are the only
+    // shared state, bumped once per POPULATION_STATS_BATCH users
+    auto fillSlice = [this, firstSlot, firstPosition, firstId](long long begin, long long end) {
+        long long offset = begin;
+        long long reported = begin;
+        while (offset < end) {
+            int band, antenna, channel;
+            long long run = layoutRun(firstPosition + offset, band, antenna, channel);
+            if (run > end - offset) run = end - offset;
+            if (stats && offset - reported >= POPULATION_STATS_BATCH) {
+                stats->recordPopulated(offset - reported);
+                reported = offset;
+            }
+            for (long long k = offset; k < offset + run; ++k) {
+                std::shared_ptr<UserDevice> user = createPopulatedUser(firstId + k, channel, antenna, band);
+                user->setDeactivationCounter(&deactivatedUsers);
+                slotLoad[(size_t)(firstSlot + k)] = (uint32_t)trafficProfiles[user->getTrafficClass()].loadUnits();
+                users.get(firstSlot + k) = std::move(user);
+            }
+            offset += run;
+        }
+        if (stats) stats->recordPopulated(end - reported);
+    };
+
+    if (bounds.size() == 2) {
+        fillSlice(0, count);
+    } else {
+        std::vector<std::exception_ptr> failures(bounds.size() - 1);
+        std::vector<std::thread> pool;
+        for (size_t i = 0; i + 1 < bounds.size(); ++i) {
+            pool.emplace_back([&fillSlice, &bounds, &failures, i]() {
+                try {
+                    fillSlice(bounds[i], bounds[i + 1]);
+                } catch (...) {
+                    failures[i] = std::current_exception();
+                }
+            });
+        }
+        for (auto& worker : pool) worker.join();
+        for (const auto& failure : failures) {
+            if (!failure) continue;
+            users.resize(firstSlot);
+            slotLoad.resize((size_t)firstSlot);
+            std::rethrow_exception(failure);
+        }
+    }
+
+    // occupancy once per cell run, after the workers are done
+    long long done = 0;
+    while (done < count) {
+        int band, antenna, channel;
+        long long run = layoutRun(firstPosition + done, band, antenna, channel);
+        if (run > count - done) run = count - done;
+        occupancy.add(band, antenna, channel, (int)run);
+        done += run;
+    }
+    nextDeviceId += count;
+    nextLayoutPosition += count;
+    activeUsers += count;
+    invalidateResourceFactor();
+    if (admissionControl) rebuildPreemptionOrder();
+}
+
+std::shared_ptr<UserDevice> CellTower::createPopulatedUser(long long id, int channel, int antenna, int band) const {
+    std::shared_ptr<UserDevice> user = createUser(id, channel, antenna, band);
+    user->setTrafficClass(trafficMix.classForId(id));
+    return user;
+}
+
+long long CellTower::placeUser(const std::shared_ptr<UserDevice>& user) {
+    const uint32_t load = (uint32_t)trafficProfiles[user->getTrafficClass()].loadUnits();
+    long long slot;
+    if (!freeSlots.empty()) {
+        slot = freeSlots.back();
+        freeSlots.pop_back();
+        users.get(slot) = user;
+        slotLoad[slot] = load;
+    } else {
+        slot = users.size();
+        users.add(user);
+        slotLoad.push_back(load);
+    }
+    user->setDeactivationCounter(&deactivatedUsers);
+    if (!user->getIsActive()) ++deactivatedUsers;
+    if (admissionControl) preemptionOrder.push(slot, preemptionKey(*user));
+    return slot;
+}
+
+// records count users at the next layout positions without creating them
+void CellTower::recordLazyRange(long long count) {
+    if (!lazyRanges.empty()) {
+        LazyRange& last = lazyRanges.back();
+        if (last.firstId + last.count == nextDeviceId && last.firstPosition + last.count == nextLayoutPosition) {
+            last.count += count;
+        } else {
+            lazyRanges.push_back({nextDeviceId, count, nextLayoutPosition});
+        }
+    } else {
+        lazyRanges.push_back({nextDeviceId, count, nextLayoutPosition});
+    }
+
+    // occupancy is updated once per cell run, not once per user
+    long long done = 0;
+    while (done < count) {
+        int band, antenna, channel;
+        long long run = layoutRun(nextLayoutPosition + done, band, antenna, channel);
+        if (run > count - done) run = count - done;
+        occupancy.add(band, antenna, channel, (int)run);
+        done += run;
+    }
+
+    for (int cls = 0; cls < TRAFFIC_CLASS_COUNT; ++cls) {
+        lazyClassUsers[cls] += trafficMix.countInRange(static_cast<TrafficClass>(cls), nextDeviceId, count);
+    }
+    nextDeviceId += count;
+    nextLayoutPosition += count;
+    activeUsers += count;
+    lazyUsers += count;
+    invalidateResourceFactor();
+    if (stats) stats->recordPopulated(count);
+}
+
+long long CellTower::materialiseUser(long long deviceId) {
+    long long slot = findUserSlot(deviceId);
+    if (slot >= 0) return slot;
+
+    // last range starting at or before deviceId
+    auto it = std::upper_bound(lazyRanges.begin(), lazyRanges.end(), deviceId,
+                               [](long long id, const LazyRange& r) { return id < r.firstId; });
+    if (it == lazyRanges.begin()) return -1;
+    --it;
+    if (deviceId >= it->firstId + it->count) return -1;
+
+    const long long offset = deviceId - it->firstId;
+    const long long position = it->firstPosition + offset;
+    int band, antenna, channel;
+    layoutCell(position, band, antenna, channel);
+
+    // split the range around the materialised ID
+    LazyRange after = {deviceId + 1, it->count - offset - 1, position + 1};
+    it->count = offset;
+    if (it->count == 0) it = lazyRanges.erase(it);
+    else ++it;
+    if (after.count > 0) lazyRanges.insert(it, after);
+    --lazyUsers;
+
+    // already counted in occupancy and activeUsers; only the object is new
+    std::shared_ptr<UserDevice> user = createPopulatedUser(deviceId, channel, antenna, band);
+    --lazyClassUsers[user->getTrafficClass()];
+    return placeUser(user);
+}
+
+int CellTower::getDefaultUserMessages() const {
+    return createUser(0, 0, 0, 0)->getMessagesGenerated();
+}
+
+void CellTower::releaseSlot(long long slot) {
+    std::shared_ptr<UserDevice>& entry = users.get(slot);
+    if (!entry) throw NetworkException("slot already free");
+
+    if (!entry->getIsActive()) --deactivatedUsers;
+    entry->setDeactivationCounter(nullptr);
+    entry->deactivate();
+    occupancy.add(entry->getFrequencyBand(), entry->getAntennaId(), entry->getChannelId(), -1);
+    vacancies.push_back({entry->getFrequencyBand(), entry->getAntennaId(), entry->getChannelId()});
+    entry.reset();
+    slotLoad[slot] = 0;
+    preemptionOrder.remove(slot);
+    freeSlots.push_back(slot);
+    --activeUsers;
+    invalidateResourceFactor();
+}
+
+void CellTower::compactIfFragmented() {
+    long long slots = users.size();
+    if (freeSlots.empty() || slots == 0) return;
+    if ((long long)freeSlots.size() * 100 >= slots * compactionThresholdPercent) compact();
+}
+
+void CellTower::detachUser(long long slot) {
+    releaseSlot(slot);
+    compactIfFragmented();
+}
+
+void CellTower::detachUsers(const std::vector<long long>& slots) {
+    for (long long slot : slots) releaseSlot(slot);
+    compactIfFragmented();
+}
+
+long long CellTower::releaseUsers(long long count) {
+    long long released = 0;
+    while (released < count && !lazyRanges.empty()) {
+        LazyRange& last = lazyRanges.back();
+        const long long take = count - released < last.count ? count - released : last.count;
+        const long long firstId = last.firstId + last.count - take;
+        const long long firstPosition = last.firstPosition + last.count - take;
+        // the layout tail is simply handed out again; cells further in are vacancies
+        const bool layoutTail = firstPosition + take == nextLayoutPosition;
+
+        long long done = 0;
+        while (done < take) {
+            int band, antenna, channel;
+            long long run = layoutRun(firstPosition + done, band, antenna, channel);
+            if (run > take - done) run = take - done;
+            occupancy.add(band, antenna, channel, -(int)run);
+            if (!layoutTail) vacancies.insert(vacancies.end(), (size_t)run, Vacancy{band, antenna, channel});
+            done += run;
+        }
+        for (int cls = 0; cls < TRAFFIC_CLASS_COUNT; ++cls) {
+            lazyClassUsers[cls] -= trafficMix.countInRange(static_cast<TrafficClass>(cls), firstId, take);
+        }
+        if (layoutTail) nextLayoutPosition = firstPosition;
+        last.count -= take;
+        if (last.count == 0) lazyRanges.pop_back();
+        lazyUsers -= take;
+        activeUsers -= take;
+        invalidateResourceFactor();
+        released += take;
+    }
+
+    for (long long slot = users.size() - 1; slot >= 0 && released < count; --slot) {
+        if (!users.get(slot)) continue;
+        releaseSlot(slot);
+        ++released;
+    }
+    compactIfFragmented();
+    return released;
+}
+
+long long CellTower::releaseInactiveSlots() {
+    long long released = 0;
+    for (long long slot = 0; slot < users.size() && deactivatedUsers > 0; ++slot) {
+        const auto& user = users.get(slot);
+        if (!user || user->getIsActive()) continue;
+        releaseSlot(slot);
+        ++released;
+    }
+    return released;
+}
+
+long long CellTower::reclaimInactiveUsers() {
+    long long released = releaseInactiveSlots();
+    compactIfFragmented();
+    return released;
+}
+
+long long CellTower::findUserSlot(long long deviceId) const {
+    // populated towers keep device IDs equal to their slot until users churn
+    if (deviceId >= 0 && deviceId < users.size()) {
+        const auto& user = users.get(deviceId);
+        if (user && user->getDeviceId() == deviceId) return deviceId;
+    }
+    for (long long slot = 0; slot < users.size(); ++slot) {
+        const auto& user = users.get(slot);
+        if (user && user->getDeviceId() == deviceId) return slot;
+    }
+    return -1;
+}
+
+// drops free slots, keeping the remaining users in their original order
+void CellTower::compact() {
+    NetworkContainer<std::shared_ptr<UserDevice>> packed;
+    std::vector<uint32_t> packedLoad;
+    packed.reserve(activeUsers);
+    packedLoad.reserve(activeUsers);
+    for (long long slot = 0; slot < users.size(); ++slot) {
+        if (!users.get(slot)) continue;
+        packed.add(users.get(slot));
+        packedLoad.push_back(slotLoad[slot]);
+    }
+    users = std::move(packed);
+    slotLoad = std::move(packedLoad);
+    freeSlots.clear();
+    if (admissionControl) rebuildPreemptionOrder();
+}
+
+// ============================================================================
+// CellTower — user placement
+// ============================================================================
+
+// calibration sample for the expected resource factor of a placement model
+static const long long PLACEMENT_CALIBRATION_USERS = 1 << 20;
+
+void CellTower::setPlacement(PlacementModel model) {
+    if (activeUsers > 0 || nextLayoutPosition > 0) {
+        throw InvalidConfigurationException("placement must be set before the tower is populated");
+    }
+    placement = model;
+    invalidateResourceFactor();
+    usersPerChannel = nominalUsersPerChannel;
+    extraUsersPerChannel = nominalExtraUsersPerChannel;
+    expectedFactorMilli = 1000;
+
+    if (model != PLACEMENT_NONE) {
+        // the first IDs populate() hands out, up to the calibration sample
+        long long sample = (long long)numAntennas *
+                           ((long long)numChannels * usersPerChannel + (long long)numExtraChannels * extraUsersPerChannel);
+        if (sample > PLACEMENT_CALIBRATION_USERS) sample = PLACEMENT_CALIBRATION_USERS;
+        std::vector<long long> ids((size_t)sample);
+        for (long long id = 0; id < sample; ++id) ids[(size_t)id] = id;
+        uint64_t sum = UserPlacement::factorSum(model, (uint64_t)generation, ids.data(), ids.size());
+        expectedFactorMilli = sample > 0 ? (uint32_t)((sum + (uint64_t)sample / 2) / (uint64_t)sample) : 1000;
+
+        usersPerChannel = (int)((long long)nominalUsersPerChannel * 1000 / expectedFactorMilli);
+        if (usersPerChannel < 1) usersPerChannel = 1;
+        if (numExtraChannels > 0) {
+            extraUsersPerChannel = (int)((long long)nominalExtraUsersPerChannel * 1000 / expectedFactorMilli);
+            if (extraUsersPerChannel < 1) extraUsersPerChannel = 1;
+        }
+    }
+    resetOccupancy();
+}
+
+uint32_t CellTower::getResourceFactorMilli() const {
+    if (placement == PLACEMENT_NONE || activeUsers <= 0) return 1000;
+    const uint32_t cached = resourceFactorMilli.load(std::memory_order_relaxed);
+    if (cached != 0) return cached;
+
+    // device IDs of the active users, a batch at a time
+    std::vector<long long> ids;
+    ids.reserve(UserPlacement::BATCH);
+    uint64_t sum = 0;
+    auto flush = [&]() {
+        sum += UserPlacement::factorSum(placement, (uint64_t)generation, ids.data(), ids.size());
+        ids.clear();
+    };
+    forEachUserRun([&](long long firstId, long long run, int, int, int, const UserDevice*) {
+        for (long long id = firstId; id < firstId + run; ++id) {
+            ids.push_back(id);
+            if (ids.size() == UserPlacement::BATCH) flush();
+        }
+    });
+    flush();
+    const uint32_t factor = (uint32_t)((sum + (uint64_t)activeUsers / 2) / (uint64_t)activeUsers);
+    resourceFactorMilli.store(factor, std::memory_order_relaxed);
+    return factor;
+}
+
+static void outputFactor(uint32_t factorMilli) {
+    io.outputint((int)(factorMilli / 1000));
+    io.outputstring(".");
+    const int fraction = (int)(factorMilli % 1000);
+    if (fraction < 100) io.outputstring("0");
+    if (fraction < 10) io.outputstring("0");
+    io.outputint(fraction);
+}
+
+void CellTower::displayPlacement() const {
+    if (placement == PLACEMENT_NONE) return;
+    io.outputstring("User placement: ");
+    io.outputstring(placementModelName(placement));
+    io.outputstring(" (mean resource factor ");
+    outputFactor(expectedFactorMilli);
+    io.outputstring(", users per channel ");
+    io.outputint(nominalUsersPerChannel);
+    io.outputstring(" -> ");
+    io.outputint(usersPerChannel);
+    io.outputstring(")");
+    io.terminate();
+}
+
+// ============================================================================
+// CellTower — QoS admission control
+// ============================================================================
+
+void CellTower::setAdmissionControl(bool enabled) {
+    admissionControl = enabled;
+    if (enabled) rebuildPreemptionOrder();
+    else preemptionOrder.clear();
+}
+
+void CellTower::rebuildPreemptionOrder() {
+    std::vector<long long> slots;
+    std::vector<uint64_t> keys;
+    slots.reserve((size_t)users.size());
+    keys.reserve((size_t)users.size());
+    for (long long slot = 0; slot < users.size(); ++slot) {
+        const auto& user = users.get(slot);
+        if (!user) continue;
+        slots.push_back(slot);
+        keys.push_back(preemptionKey(*user));
+    }
+    preemptionOrder.build(slots, keys);
+}
+
+void CellTower::preemptLazyUser(int& band, int& antenna, int& channel) {
+    LazyRange& last = lazyRanges.back();
+    const long long deviceId = last.firstId + last.count - 1;
+    layoutCell(last.firstPosition + last.count - 1, band, antenna, channel);
+    if (--last.count == 0) lazyRanges.pop_back();
+
+    occupancy.add(band, antenna, channel, -1);
+    --lazyClassUsers[trafficMix.classForId(deviceId)];
+    --lazyUsers;
+    --activeUsers;
+    invalidateResourceFactor();
+}
+
+std::shared_ptr<UserDevice> CellTower::createArrival(QosClass cls) const {
+    // a full tower's arrival only gets in by pre-emption, which moves it to
+    // the victim's cell; (0, 0, 0) is just a placeholder then
+    int band = 0, antenna = 0, channel = 0;
+    if (!vacancies.empty()) {
+        band = vacancies.back().band;
+        antenna = vacancies.back().antenna;
+        channel = vacancies.back().channel;
+    } else if (nextLayoutPosition < getTotalCapacity()) {
+        layoutCell(nextLayoutPosition, band, antenna, channel);
+    }
+    std::shared_ptr<UserDevice> user = createPopulatedUser(nextDeviceId, channel, antenna, band);
+    user->setQosClass(cls);
+    return user;
+}
+
+AdmissionResult CellTower::admitUser(std::shared_ptr<UserDevice> user) {
+    if (!user) throw NetworkException("null user");
+    const QosClass arriving = user->getQosClass();
+    AdmissionResult result = {false, -1, -1, QOS_BEST_EFFORT};
+
+    if (hasRoom()) {
+        result.slot = addUser(user);
+        // an arrival placed in the last vacated cell or at the next layout
+        // position (see createArrival) fills it
+        const int band = user->getFrequencyBand(), antenna = user->getAntennaId(), channel = user->getChannelId();
+        if (!vacancies.empty() && vacancies.back().band == band &&
+            vacancies.back().antenna == antenna && vacancies.back().channel == channel) {
+            vacancies.pop_back();
+        } else if (nextLayoutPosition < getTotalCapacity()) {
+            int nextBand, nextAntenna, nextChannel;
+            layoutCell(nextLayoutPosition, nextBand, nextAntenna, nextChannel);
+            if (nextBand == band && nextAntenna == antenna && nextChannel == channel) ++nextLayoutPosition;
+        }
+        result.admitted = true;
+        ++admittedByClass[arriving];
+        return result;
+    }
+    if (!admissionControl) throw NetworkException("admission control is off");
+
+    // the most pre-emptable user: heap top, or the newest lazy user (best-effort)
+    const bool heapHasUsers = !preemptionOrder.empty();
+    const uint64_t lazyKey = lazyUsers > 0
+        ? ((uint64_t)QOS_BEST_EFFORT << 56) | (uint64_t)(lazyRanges.back().firstId + lazyRanges.back().count - 1)
+        : 0;
+    const bool takeLazy = lazyUsers > 0 && (!heapHasUsers || lazyKey > preemptionOrder.topKey());
+    const uint64_t victimKey = takeLazy ? lazyKey : (heapHasUsers ? preemptionOrder.topKey() : 0);
+    const QosClass victimClass = static_cast<QosClass>(victimKey >> 56);
+
+    if ((!takeLazy && !heapHasUsers) || victimClass <= arriving) {
+        ++rejectedByClass[arriving];
+        return result;
+    }
+
+    int band, antenna, channel;
+    if (takeLazy) {
+        result.preemptedDeviceId = (long long)(lazyKey & ((1ULL << 56) - 1));
+        preemptLazyUser(band, antenna, channel);
+    } else {
+        const long long slot = preemptionOrder.topSlot();
+        const UserDevice& victim = *users.get(slot);
+        result.preemptedDeviceId = victim.getDeviceId();
+        band = victim.getFrequencyBand();
+        antenna = victim.getAntennaId();
+        channel = victim.getChannelId();
+        releaseSlot(slot);
+        vacancies.pop_back();   // the arrival takes the cell over
+    }
+    result.preemptedClass = victimClass;
+    ++preemptedByClass[victimClass];
+
+    user->setFrequencyBand(band);
+    user->setAntennaId(antenna);
+    user->setChannelId(channel);
+    result.slot = addUser(user);
+    result.admitted = true;
+    ++admittedByClass[arriving];
+    return result;
+}
+
+// ============================================================================
+// CellTower — traffic profiles and aggregate load
+// ============================================================================
+
+void CellTower::setTrafficProfile(TrafficClass cls, const TrafficProfile& profile) {
+    profile.validate();
+    trafficProfiles[cls] = profile;
+    refreshSlotLoads();
+}
+
+void CellTower::setTrafficMix(const TrafficMix& mix) {
+    mix.validate();
+    trafficMix = mix;
+    onlyDataUsers = mix.isAllData() && (onlyDataUsers || (activeUsers == 0 && deactivatedUsers == 0));
+}
+
+void CellTower::refreshSlotLoads() {
+    for (long long slot = 0; slot < users.size(); ++slot) {
+        const auto& user = users.get(slot);
+        slotLoad[slot] = user ? (uint32_t)trafficProfiles[user->getTrafficClass()].loadUnits() : 0;
+    }
+}
+
+long long CellTower::getNumUsersInClass(TrafficClass cls) const {
+    long long count = lazyClassUsers[cls];
+    for (const auto& user : users) {
+        if (user && user->getTrafficClass() == cls) ++count;
+    }
+    return count;
+}
+
+unsigned long long CellTower::getTrafficLoad() const {
+    // plain reduction over the contiguous load array; free slots hold 0, so
+    // there is no branch and the compiler vectorises the loop
+    const uint32_t* load = slotLoad.data();
+    const size_t slots = slotLoad.size();
+    unsigned long long total = 0;
+    for (size_t i = 0; i < slots; ++i) total += load[i];
+
+    for (int cls = 0; cls < TRAFFIC_CLASS_COUNT; ++cls) {
+        total += (unsigned long long)lazyClassUsers[cls] * trafficProfiles[cls].loadUnits();
+    }
+    return total;
+}
+
 void CellTower::displayFirstChannelUsers() const {
     io.outputstring("Users on first channel: ");
-    int count = 0;
-    const auto& container = getUsers();
-    for (int i = 0; i < container.size(); ++i) {
-        const auto& user = container.get(i);
-        if (!user) continue;
-        if (user->getChannelId() == 0 && user->getAntennaId() == 0) {
+    long long count = 0;
+    forEachUserRun([&count](long long firstId, long long run, int channel, int antenna, int band,
+                            const UserDevice*) {
+        if (channel != 0 || antenna != 0 || band != 0) return;
+        for (long long id = firstId; id < firstId + run; ++id) {
             if (count > 0) io.outputstring(", ");
-            io.outputint(user->getDeviceId());
+            io.outputlong(id);
             ++count;
         }
-    }
+    });
     if (count == 0) io.outputstring("None");
     io.terminate();
 }
 
 void CellTower::displayTotalCapacity() const {
     io.outputstring("Total capacity: ");
-    io.outputint(getTotalCapacity());
+    io.outputlong(getTotalCapacity());
     io.outputstring(" users");
     io.terminate();
 }
 
 void CellTower::displayCoresNeeded(int messagesPerUser, int overheadPer100Messages) const {
     io.outputstring("Cellular cores needed: ");
-    io.outputint(calculateCoresNeeded(messagesPerUser, overheadPer100Messages));
+    io.outputlong(calculateCoresNeeded(messagesPerUser, overheadPer100Messages));
+    io.terminate();
+}
+
+void CellTower::displayTrafficCoresNeeded(int overheadPer100Messages) const {
+    io.outputstring("Cellular cores needed: ");
+    io.outputlong(calculateCoresForTraffic(overheadPer100Messages));
     io.terminate();
 }
 
-int CellTower::calculateCoresNeeded(int messagesPerUser, int overheadPer100Messages) const {
+void CellTower::displayTrafficMix() const {
+    if (trafficMix.isAllData()) return;
+    io.outputstring("Traffic mix:");
+    for (int cls = 0; cls < TRAFFIC_CLASS_COUNT; ++cls) {
+        if (trafficMix.percent[cls] == 0) continue;
+        io.outputstring(" ");
+        io.outputstring(trafficClassName(static_cast<TrafficClass>(cls)));
+        io.outputstring(" ");
+        io.outputint(trafficMix.percent[cls]);
+        io.outputstring("% (");
+        io.outputint(trafficProfiles[cls].messages);
+        io.outputstring(" msgs, +");
+        io.outputint(trafficProfiles[cls].overheadPer100Messages);
+        io.outputstring("/100)");
+    }
+    io.terminate();
+}
+
+long long CellTower::calculateCoresNeeded(int messagesPerUser, int overheadPer100Messages) const {
     long long totalUsers = getNumUsers();
     if (totalUsers <= 0 || messagesPerUser <= 0) return 0;
 
     long long totalMessages = totalUsers * (long long)messagesPerUser;
+    if (placement != PLACEMENT_NONE) totalMessages = (totalMessages * getResourceFactorMilli() + 999) / 1000;
+    return coresForMessages(getGeneration(), totalMessages, overheadPer100Messages);
+}
+
+long long CellTower::calculateCoresForTraffic(int overheadPer100Messages) const {
+    if (getNumUsers() <= 0) return 0;
+    // class overheads are already folded into the load; round up to whole messages
+    uint64_t load = getTrafficLoad();
+    if (placement != PLACEMENT_NONE) load = (load * getResourceFactorMilli() + 999) / 1000;
+    long long totalMessages = (long long)((load + 99) / 100);
+    if (totalMessages <= 0) return 0;
+    return coresForMessages(getGeneration(), totalMessages, overheadPer100Messages);
+}
+
+long long CellTower::baseMessagesPerCore(GenerationType gen) {
 
     // === SMALL-SCALE CONSTANTS THAT BEHAVE LIKE YOU WANT ===
     long long baseCapacityMsgsPerCore = 0;
-    switch (getGeneration()) {
+    switch (gen) {
 	case GEN_2G:
     	    baseCapacityMsgsPerCore = 5000;     // baseline
     	    break;
@@ -66,7 +878,11 @@ int CellTower::calculateCoresNeeded(int messagesPerUser, int overheadPer100Messa
 	default:
     	    baseCapacityMsgsPerCore = 5000;
     }
+    return baseCapacityMsgsPerCore;
+}
 
+long long CellTower::coresForMessages(GenerationType gen, long long totalMessages, int overheadPer100Messages) {
+    long long baseCapacityMsgsPerCore = baseMessagesPerCore(gen);
 
     long long effectiveCapacity =
         (baseCapacityMsgsPerCore * (100LL - overheadPer100Messages)) / 100LL;
@@ -77,11 +893,190 @@ int CellTower::calculateCoresNeeded(int messagesPerUser, int overheadPer100Messa
 
     if (coresNeeded < 1) coresNeeded = 1;
 
-    return (int)coresNeeded;
+    return coresNeeded;
+}
+
+
+
+
+// ============================================================================
+// CellTower — core allocation (bin packing of channels onto cores)
+// ============================================================================
+
+CoreAllocation CellTower::allocateCores(int overheadPer100Messages, CoreGranularity granularity) {
+    // traffic per (band, antenna, channel) cell, indexed like the occupancy cube
+    const int widest = numChannels > numExtraChannels ? numChannels : numExtraChannels;
+    const size_t groups = (size_t)getNumBands() * numAntennas;
+    std::vector<uint64_t> cellLoad(groups * widest, 0);
+    uint64_t classUnits[TRAFFIC_CLASS_COUNT];
+    for (int cls = 0; cls < TRAFFIC_CLASS_COUNT; ++cls) classUnits[cls] = trafficProfiles[cls].loadUnits();
+
+    if (onlyDataUsers) {
+        // every user carries the data load: the occupancy counts give it per cell
+        const int32_t* counts = occupancy.cellCounts();
+        for (size_t cell = 0; cell < cellLoad.size(); ++cell) {
+            cellLoad[cell] = (uint64_t)counts[cell] * classUnits[TRAFFIC_DATA];
+        }
+    } else {
+        forEachUserRun([&](long long firstId, long long run, int channel, int antenna, int band,
+                           const UserDevice* device) {
+            uint64_t& load = cellLoad[((size_t)band * numAntennas + antenna) * widest + channel];
+            if (device) {
+                load += classUnits[device->getTrafficClass()];
+            } else {
+                for (int cls = 0; cls < TRAFFIC_CLASS_COUNT; ++cls) {
+                    load += (uint64_t)trafficMix.countInRange(static_cast<TrafficClass>(cls), firstId, run) *
+                            classUnits[cls];
+                }
+            }
+        });
+    }
+    if (placement != PLACEMENT_NONE) {
+        const uint64_t factor = getResourceFactorMilli();
+        for (uint64_t& load : cellLoad) load = (load * factor + 999) / 1000;
+    }
+
+    CellularCore prototype(0, overheadPer100Messages, (int)baseMessagesPerCore(generation));
+    const uint64_t capacity = (uint64_t)prototype.getMaxMessages() * 100;
+
+    // items: whole channels, or whole antenna groups where one fits on a core
+    // (a group too big for any core is packed channel by channel instead)
+    CoreAllocation result;
+    result.granularity = granularity;
+    result.splitGroups = 0;
+    std::vector<uint64_t> items;
+    if (granularity == PACK_PER_ANTENNA) {
+        for (size_t group = 0; group < groups; ++group) {
+            const uint64_t* channels = &cellLoad[group * widest];
+            uint64_t groupLoad = 0;
+            for (int channel = 0; channel < widest; ++channel) groupLoad += channels[channel];
+            if (groupLoad <= capacity) {
+                items.push_back(groupLoad);
+                continue;
+            }
+            ++result.splitGroups;
+            items.insert(items.end(), channels, channels + widest);
+        }
+    } else {
+        items.swap(cellLoad);
+    }
+
+    // the reported solve time covers the packing alone, not gathering the loads
+    auto started = std::chrono::steady_clock::now();
+    CoreAllocator::Packing packing = CoreAllocator::firstFitDecreasing(items, capacity);
+
+    cores.clear();
+    cores.reserve(packing.coreLoad.size());
+    uint64_t servedLoad = 0;
+    for (size_t core = 0; core < packing.coreLoad.size(); ++core) {
+        cores.emplace_back((int)core, overheadPer100Messages, (int)baseMessagesPerCore(generation));
+        cores.back().assignLoad(packing.coreLoad[core]);
+        servedLoad += packing.coreLoad[core] < capacity ? packing.coreLoad[core] : capacity;
+    }
+
+    result.items = 0;
+    result.totalLoad = 0;
+    for (uint64_t load : items) {
+        if (load == 0) continue;
+        ++result.items;
+        result.totalLoad += load;
+    }
+    result.cores = (long long)cores.size();
+    result.lowerBound = calculateCoresForTraffic(overheadPer100Messages);
+    result.oversizedItems = packing.oversizedItems;
+    result.maxMessagesPerCore = prototype.getMaxMessages();
+    // overloaded cores only count up to their capacity
+    result.efficiencyPerMille = result.cores > 0
+        ? (int)(servedLoad * 1000 / ((unsigned long long)result.cores * capacity)) : 0;
+    result.solveMicros = (long long)std::chrono::duration_cast<std::chrono::microseconds>(
+        std::chrono::steady_clock::now() - started).count();
+    return result;
 }
 
+// ============================================================================
+// CellTower — message latency (queueing model on CellularCore)
+// ============================================================================
+
+// messages simulated across all cores; each core gets at least the minimum so
+// its tail percentiles are still meaningful on towers with many cores
+static const long long LATENCY_SAMPLE_BUDGET = 2000000;
+static const long long LATENCY_MIN_SAMPLES_PER_CORE = 1000;
+
+// splitmix64: cheap, well-mixed per-core random stream
+static uint64_t nextRandom(uint64_t& state) {
+    uint64_t z = (state += 0x9E3779B97F4A7C15ULL);
+    z = (z ^ (z >> 30)) * 0xBF58476D1CE4E5B9ULL;
+    z = (z ^ (z >> 27)) * 0x94D049BB133111EBULL;
+    return z ^ (z >> 31);
+}
 
+long long CellTower::simulateMessageLatency(int overheadPer100Messages, LatencyHistogram& histogram,
+                                            int threads) const {
+    const long long cores = calculateCoresForTraffic(overheadPer100Messages);
+    if (cores <= 0) return 0;
+
+    // per-class share of the messages and the service weight of one message,
+    // which grows with the radio resources the users need
+    const uint32_t placementFactor = placement != PLACEMENT_NONE ? getResourceFactorMilli() : 1000;
+    long long classMessages[TRAFFIC_CLASS_COUNT];
+    uint32_t messageUnits[TRAFFIC_CLASS_COUNT];
+    long long totalMessages = 0;
+    for (int cls = 0; cls < TRAFFIC_CLASS_COUNT; ++cls) {
+        classMessages[cls] = getNumUsersInClass(static_cast<TrafficClass>(cls)) * trafficProfiles[cls].messages;
+        messageUnits[cls] = trafficProfiles[cls].messageUnits();
+        if (placement != PLACEMENT_NONE) messageUnits[cls] = (messageUnits[cls] * placementFactor + 999) / 1000;
+        totalMessages += classMessages[cls];
+    }
+    if (totalMessages <= 0) return 0;
+
+    // messages are spread evenly over the cores within a one-second window
+    const double arrivalsPerSecond = (double)totalMessages / (double)cores;
+    const double meanGapNs = 1e9 / arrivalsPerSecond;
+    long long samplesPerCore = (totalMessages + cores - 1) / cores;
+    long long budgetPerCore = LATENCY_SAMPLE_BUDGET / cores;
+    if (budgetPerCore < LATENCY_MIN_SAMPLES_PER_CORE) budgetPerCore = LATENCY_MIN_SAMPLES_PER_CORE;
+    if (samplesPerCore > budgetPerCore) samplesPerCore = budgetPerCore;
+
+    const int baseCapacity = (int)baseMessagesPerCore(generation);
+    auto simulateCores = [&](long long firstCore, long long stride, LatencyHistogram& out) {
+        for (long long id = firstCore; id < cores; id += stride) {
+            CellularCore core((int)id, overheadPer100Messages, baseCapacity);
+            uint64_t random = (uint64_t)(id + 1) * 0xD1B54A32D192ED03ULL;
+            double clockNs = 0.0;
+            for (long long n = 0; n < samplesPerCore; ++n) {
+                // exponential inter-arrival gap from a uniform in (0, 1]
+                double uniform = (double)((nextRandom(random) >> 11) + 1) * (1.0 / 9007199254740992.0);
+                clockNs += -std::log(uniform) * meanGapNs;
+
+                long long pick = (long long)(nextRandom(random) % (uint64_t)totalMessages);
+                int cls = 0;
+                while (pick >= classMessages[cls]) pick -= classMessages[cls++];
+
+                out.record(core.processMessage((uint64_t)clockNs, messageUnits[cls]));
+            }
+        }
+    };
+
+    long long workers = threads > 0 ? threads : (long long)std::thread::hardware_concurrency();
+    if (workers < 1) workers = 1;
+    if (workers > cores) workers = cores;
+    if (workers == 1) {
+        simulateCores(0, 1, histogram);
+        return cores;
+    }
 
+    // each worker fills a private histogram and merges it once at the end
+    std::vector<std::thread> pool;
+    for (long long w = 0; w < workers; ++w) {
+        pool.emplace_back([&simulateCores, &histogram, w, workers]() {
+            std::unique_ptr<LatencyHistogram> local(new LatencyHistogram());
+            simulateCores(w, workers, *local);
+            histogram.merge(*local);
+        });
+    }
+    for (auto& worker : pool) worker.join();
+    return cores;
+}
 
 // ============================================================================
 // Tower5G - specialized first-channel display (filters by frequency band)
@@ -89,86 +1084,434 @@ int CellTower::calculateCoresNeeded(int messagesPerUser, int overheadPer100Messa
 
 void Tower5G::displayFirstChannelUsers() const {
     io.outputstring("Users on first channel: ");
-    int count = 0;
-    const auto& container = getUsers();
-    for (int i = 0; i < container.size(); ++i) {
-        const auto& userPtr = container.get(i);
-        if (!userPtr) continue;
+    long long count = 0;
+    forEachUserRun([&count](long long firstId, long long run, int channel, int antenna, int band,
+                            const UserDevice* device) {
         // Only show users that are in channel 0, antenna 0, and primary band (band == 0)
-        if (userPtr->getChannelId() == 0 && userPtr->getAntennaId() == 0) {
-            User5G* u5 = dynamic_cast<User5G*>(userPtr.get());
-            if (u5 && u5->getFrequencyBand() == 0) {
-                if (count > 0) io.outputstring(", ");
-                io.outputint(u5->getDeviceId());
-                ++count;
-            }
+        if (channel != 0 || antenna != 0 || band != 0) return;
+        if (device && !dynamic_cast<const User5G*>(device)) return;
+        for (long long id = firstId; id < firstId + run; ++id) {
+            if (count > 0) io.outputstring(", ");
+            io.outputlong(id);
+            ++count;
         }
-    }
+    });
     if (count == 0) io.outputstring("None");
     io.terminate();
 }
 
 // ============================================================================
-// 2G Simulation
+// Structured results for the tower that was just simulated
 // ============================================================================
-void CellularNetworkSimulator::simulate2G() {
-    io.outputstring("\n========== 2G COMMUNICATION SIMULATION ==========");
-    io.terminate();
+void CellularNetworkSimulator::writeResults(const CellTower& tower, ResultWriter* writer,
+                                            int messagesPerUser, int overheadPer100Messages, long long cores,
+                                            const LatencyHistogram* latency,
+                                            const CoreAllocation* allocation) const {
+    if (!writer || !writer->isEnabled()) return;
+
+    const GenerationType gen = tower.getGeneration();
+
+    writer->writeTowerCapacity(gen, tower.getTotalCapacity(), tower.getNumChannels(),
+                               tower.getUsersPerChannel(), tower.getNumAntennas());
+    writer->writeTowerOccupancy(tower);
+    if (saturatedCells > 0) writer->writeSaturatedCells(tower, saturatedCells, saturationPercent);
+    writer->writeCoreCount(gen, messagesPerUser, overheadPer100Messages, cores);
+    writer->writeScenarioResult(gen, tower.getNumAntennas(), overheadPer100Messages,
+                                messagesPerUser, tower.getNumUsers(), tower.getTotalCapacity(), cores);
+    if (allocation) writer->writeCorePacking(gen, *allocation);
+    if (latency && latency->getTotalCount() > 0) writer->writeLatency(gen, "tower", *latency);
+    if (overloadArrivals > 0) writer->writeAdmission(tower);
+    if (includeUserRows) writer->writeTowerUsers(tower);
+    writer->flush();
+}
 
-    try {
-        currentTower = std::make_shared<Tower2G>();
-        currentGeneration = GEN_2G;
+// ============================================================================
+// Message latency reporting
+// ============================================================================
+static void outputLatencyPercentiles(const LatencyHistogram& histogram) {
+    io.outputstring("p50 ");
+    io.outputlong((long long)histogram.valueAtPerMillion(500000));
+    io.outputstring(" ns, p99 ");
+    io.outputlong((long long)histogram.valueAtPerMillion(990000));
+    io.outputstring(" ns, p99.9 ");
+    io.outputlong((long long)histogram.valueAtPerMillion(999000));
+    io.outputstring(" ns");
+}
 
-        int totalCapacity = currentTower->getTotalCapacity();
+void CellularNetworkSimulator::setLatencyReport(bool enabled) {
+    latencyReport = enabled;
+    for (int gen = GEN_2G; gen <= GEN_5G; ++gen) {
+        if (enabled && !generationLatency[gen]) generationLatency[gen].reset(new LatencyHistogram());
+    }
+}
 
-        io.outputstring("Technology: TDMA (Time Division Multiple Access)");
-        io.terminate();
-        io.outputstring("Bandwidth: 1 MHz (1000 kHz)");
+void CellularNetworkSimulator::reportLatency(GenerationType gen, const LatencyHistogram& histogram,
+                                             long long cores) {
+    io.outputstring("Message latency: ");
+    if (histogram.getTotalCount() == 0) {
+        io.outputstring("no traffic");
         io.terminate();
-        io.outputstring("Channel bandwidth: 200 kHz");
+        return;
+    }
+    outputLatencyPercentiles(histogram);
+    io.outputstring(" (");
+    io.outputlong((long long)histogram.getTotalCount());
+    io.outputstring(" messages sampled on ");
+    io.outputlong(cores);
+    io.outputstring(cores == 1 ? " core)" : " cores)");
+    io.terminate();
+    generationLatency[gen]->merge(histogram);
+}
+
+// Core count (and latency) of a populated tower, served from the scenario
+// cache when the same scenario was analysed before.
+void CellularNetworkSimulator::analyseTower(CellTower& tower, ResultWriter* writer,
+                                            int messagesPerUser, int overheadPer100Messages) {
+    ScenarioKey key = ScenarioKey::describe(tower, messagesPerUser, overheadPer100Messages, latencyReport);
+    ScenarioResult result;
+    if (!scenarioCache || !scenarioCache->lookup(key, result)) {
+        result.totalCapacity = tower.getTotalCapacity();
+        result.users = tower.getNumUsers();
+        result.cores = tower.calculateCoresForTraffic(overheadPer100Messages);
+        if (latencyReport) {
+            std::shared_ptr<LatencyHistogram> latency(new LatencyHistogram());
+            tower.simulateMessageLatency(overheadPer100Messages, *latency, towerThreads);
+            result.latency = latency;
+        }
+        if (scenarioCache) scenarioCache->store(key, result);
+    }
+    if (stats) stats->recordTower(result.cores);
+
+    io.outputstring("Cellular cores needed: ");
+    io.outputlong(result.cores);
+    io.terminate();
+
+    CoreAllocation allocation;
+    if (corePacking) {
+        allocation = tower.allocateCores(overheadPer100Messages, packingGranularity);
+        reportCorePacking(allocation);
+    }
+    if (latencyReport && result.latency) reportLatency(tower.getGeneration(), *result.latency, result.cores);
+    if (overloadArrivals > 0) runOverload(tower);
+    writeResults(tower, writer, messagesPerUser, overheadPer100Messages, result.cores, result.latency.get(),
+                 corePacking ? &allocation : nullptr);
+}
+
+// Offers overloadArrivals new users to the (full) tower under admission
+// control; every 100 arrivals hold 5 emergency, 25 voice and 70 best-effort.
+void CellularNetworkSimulator::runOverload(CellTower& tower) const {
+    const long long STATS_BATCH = 65536;   // arrivals between live stats updates
+    long long admittedBatch = 0, rejectedBatch = 0;
+    tower.setAdmissionControl(true);
+    for (long long i = 0; i < overloadArrivals; ++i) {
+        const long long share = i % 100;
+        const QosClass cls = share < 5 ? QOS_EMERGENCY : (share < 30 ? QOS_VOICE : QOS_BEST_EFFORT);
+        if (tower.admitUser(tower.createArrival(cls)).admitted) ++admittedBatch;
+        else ++rejectedBatch;
+        if (stats && admittedBatch + rejectedBatch == STATS_BATCH) {
+            stats->recordAdmissions(admittedBatch, rejectedBatch);
+            admittedBatch = rejectedBatch = 0;
+        }
+    }
+    tower.setAdmissionControl(false);
+    if (stats) stats->recordAdmissions(admittedBatch, rejectedBatch);
+
+    long long preempted = 0, rejected = 0;
+    for (int cls = 0; cls < QOS_CLASS_COUNT; ++cls) {
+        preempted += tower.getPreemptedCount(static_cast<QosClass>(cls));
+        rejected += tower.getRejectedCount(static_cast<QosClass>(cls));
+    }
+    io.outputstring("Overload: ");
+    io.outputlong(overloadArrivals);
+    io.outputstring(" arrivals, ");
+    io.outputlong(preempted);
+    io.outputstring(" pre-empted, ");
+    io.outputlong(rejected);
+    io.outputstring(" rejected");
+    io.terminate();
+    for (int cls = 0; cls < QOS_CLASS_COUNT; ++cls) {
+        const QosClass qos = static_cast<QosClass>(cls);
+        io.outputstring("  ");
+        io.outputstring(qosClassName(qos));
+        io.outputstring(": ");
+        io.outputlong(tower.getAdmittedCount(qos));
+        io.outputstring(" admitted, ");
+        io.outputlong(tower.getPreemptedCount(qos));
+        io.outputstring(" pre-empted, ");
+        io.outputlong(tower.getRejectedCount(qos));
+        io.outputstring(" rejected");
         io.terminate();
-        io.outputstring("Number of channels: ");
-        io.outputint(1000 / 200);
+    }
+}
+
+void CellularNetworkSimulator::reportCorePacking(const CoreAllocation& allocation) const {
+    io.outputstring("Cores with whole ");
+    io.outputstring(allocation.granularity == PACK_PER_ANTENNA ? "antenna groups" : "channels");
+    io.outputstring(": ");
+    io.outputlong(allocation.cores);
+    io.outputstring(" (");
+    io.outputlong(allocation.items);
+    io.outputstring(" items, ");
+    io.outputint(allocation.efficiencyPerMille / 10);
+    io.outputstring(".");
+    io.outputint(allocation.efficiencyPerMille % 10);
+    io.outputstring("% packed, lower bound ");
+    io.outputlong(allocation.lowerBound);
+    io.outputstring(", solved in ");
+    io.outputlong(allocation.solveMicros);
+    io.outputstring(" us)");
+    io.terminate();
+    if (allocation.splitGroups > 0) {
+        io.outputlong(allocation.splitGroups);
+        io.outputstring(" antenna groups exceed one core and were packed by channel");
         io.terminate();
-        io.outputstring("Users per channel: 16");
+    }
+    if (allocation.oversizedItems > 0) {
+        io.outputstring("Warning: ");
+        io.outputlong(allocation.oversizedItems);
+        io.outputstring(" channels exceed one core (");
+        io.outputint(allocation.maxMessagesPerCore);
+        io.outputstring(" messages) and overload their core");
         io.terminate();
-        io.outputstring("Messages per user: 20 (5 data + 15 voice)");
+    }
+}
+
+void CellularNetworkSimulator::displayLatencySummary() const {
+    if (!latencyReport) return;
+    io.outputstring("\nMessage latency by generation (all towers simulated):");
+    io.terminate();
+    for (int gen = GEN_2G; gen <= GEN_5G; ++gen) {
+        const LatencyHistogram& histogram = *generationLatency[gen];
+        if (histogram.getTotalCount() == 0) continue;
+        io.outputstring("  ");
+        io.outputstring(generationName(static_cast<GenerationType>(gen)));
+        io.outputstring(": ");
+        outputLatencyPercentiles(histogram);
         io.terminate();
+        if (results && results->isEnabled()) {
+            results->writeLatency(static_cast<GenerationType>(gen), "generation", histogram);
+        }
+    }
+    if (results && results->isEnabled()) results->flush();
+}
 
-        currentTower->displayTotalCapacity();
+// ============================================================================
+// Shared helpers for the per-generation simulations
+// ============================================================================
 
-        io.outputstring("\nAdding users to first channel (0-200 kHz)...");
-        io.terminate();
+// "1 MHz (1000 kHz)" for whole megahertz, otherwise "<n> kHz"
+static void outputBandwidth(int kHz) {
+    if (kHz >= 1000 && kHz % 1000 == 0) {
+        io.outputint(kHz / 1000);
+        io.outputstring(" MHz (");
+        io.outputint(kHz);
+        io.outputstring(" kHz)");
+    } else {
+        io.outputint(kHz);
+        io.outputstring(" kHz");
+    }
+}
+
+// "10 MHz" for whole megahertz, otherwise "<n> kHz"
+static void outputBandwidthShort(int kHz) {
+    if (kHz >= 1000 && kHz % 1000 == 0) {
+        io.outputint(kHz / 1000);
+        io.outputstring(" MHz");
+    } else {
+        io.outputint(kHz);
+        io.outputstring(" kHz");
+    }
+}
+
+static void outputChannelLayout(const CellTower& tower) {
+    io.outputstring("Channel bandwidth: ");
+    io.outputint(tower.getChannelBandwidth());
+    io.outputstring(" kHz");
+    io.terminate();
+    io.outputstring("Number of channels: ");
+    io.outputint(tower.getNumChannels());
+    io.terminate();
+    io.outputstring("Users per channel: ");
+    io.outputint(tower.getUsersPerChannel());
+    io.terminate();
+}
+
+static void outputAddingFirstChannel(const CellTower& tower, const char* suffix) {
+    io.outputstring("\nAdding users to first channel (0-");
+    io.outputint(tower.getChannelBandwidth());
+    io.outputstring(" kHz");
+    io.outputstring(suffix);
+    io.outputstring(")...");
+    io.terminate();
+}
+
+// prompt for overhead per 100 messages (default 0)
+static int readOverhead() {
+    io.outputstring("\nEnter overhead per 100 messages (0-100) [default 0]: ");
+    char buf[32] = {0};
+    io.inputstring(buf, 32);
+    int overhead = atoi(buf);
+    if (buf[0] == '\0') overhead = 0;
+    if (overhead < 0) overhead = 0;
+    return overhead;
+}
+
+// number of interactive answers a generation reads (antennas, then overhead)
+static int inputLinesFor(GenerationType gen) {
+    return (gen == GEN_4G || gen == GEN_5G) ? 2 : 1;
+}
 
-        int usersInFirstChannel = 16;
-        for (int i = 0; i < usersInFirstChannel; ++i) {
-            auto user = std::make_shared<User2G>(i, 0);
-            currentTower->addUser(user);
+// prompt for the antenna count (1..maxAntennas, default maxAntennas)
+static int readAntennas(const char* genName, int maxAntennas) {
+    io.outputstring("Enter number of antennas for ");
+    io.outputstring(genName);
+    io.outputstring(" (1-");
+    io.outputint(maxAntennas);
+    io.outputstring(") [default ");
+    io.outputint(maxAntennas);
+    io.outputstring("]: ");
+    char buf[32] = {0};
+    io.inputstring(buf, 32);
+    int antennas = atoi(buf);
+    if (buf[0] == '\0') antennas = maxAntennas;
+    if (antennas < 1 || antennas > maxAntennas) antennas = maxAntennas;
+    return antennas;
+}
+
+// ============================================================================
+// Generation dispatch
+// ============================================================================
+std::shared_ptr<CellTower> CellularNetworkSimulator::configureTower(GenerationType gen) const {
+    std::shared_ptr<CellTower> tower = CellTower::create(gen, towerConfigs[gen]);
+    tower->setPopulationThreads(towerThreads);
+    tower->setLazyPopulation(lazyPopulation);
+    tower->setTrafficMix(trafficMix);
+    if (placement != PLACEMENT_NONE) tower->setPlacement(placement);
+    for (int cls = 0; cls < TRAFFIC_CLASS_COUNT; ++cls) {
+        if (trafficOverrides[cls].messages >= 0) {
+            tower->setTrafficProfile(static_cast<TrafficClass>(cls), trafficOverrides[cls]);
+        }
+    }
+    return tower;
+}
+
+std::shared_ptr<CellTower> CellularNetworkSimulator::createTower(GenerationType gen) {
+    std::shared_ptr<CellTower> tower = configureTower(gen);
+    tower->setStats(stats);
+    // cached scenarios only need the (instant) lazy population for the displays
+    if (scenarioCache) tower->setLazyPopulation(true);
+    generationTowers[gen] = tower;
+    return tower;
+}
+
+void CellularNetworkSimulator::runGeneration(GenerationType gen, ResultWriter* writer) {
+    switch (gen) {
+        case GEN_2G: run2G(writer); break;
+        case GEN_3G: run3G(writer); break;
+        case GEN_4G: run4G(writer); break;
+        case GEN_5G: run5G(writer); break;
+    }
+}
+
+void CellularNetworkSimulator::simulateGeneration(GenerationType gen) {
+    runGeneration(gen, results);
+    currentTower = generationTowers[gen];
+    currentGeneration = gen;
+}
+
+void CellularNetworkSimulator::simulateAll() {
+    if (parallelAll) {
+        simulateAllParallel();
+        displayLatencySummary();
+        return;
+    }
+    simulate2G();
+    simulate3G();
+    simulate4G();
+    simulate5G();
+    displayLatencySummary();
+}
+
+void CellularNetworkSimulator::simulateAllParallel() {
+    IOCapture captures[4];
+    std::unique_ptr<ResultWriter> writers[4];
+    const bool structured = results && results->isEnabled();
+
+    // the answers each generation would have read, in sequential order
+    for (int gen = GEN_2G; gen <= GEN_5G; ++gen) {
+        for (int line = 0; line < inputLinesFor(static_cast<GenerationType>(gen)); ++line) {
+            char buf[32] = {0};
+            io.inputstring(buf, 32);
+            captures[gen].inputLines.push_back(buf);
         }
+        if (structured) writers[gen].reset(new ResultWriter(results->getFormat(), ResultWriter::IN_MEMORY, 64u << 10));
+    }
 
-        int channelId = 1;
-        int usersInChannel = 0;
-        for (int i = usersInFirstChannel; i < totalCapacity; ++i) {
-            auto user = std::make_shared<User2G>(i, channelId);
-            currentTower->addUser(user);
-            usersInChannel++;
-            if (usersInChannel >= 16) {
-                channelId++;
-                usersInChannel = 0;
+    // the four generations share the hardware threads instead of each
+    // starting one population / latency worker per hardware thread
+    const int unlimited = towerThreads;
+    const int hardware = (int)std::thread::hardware_concurrency();
+    towerThreads = hardware / 4 > 1 ? hardware / 4 : 1;
+
+    std::vector<std::thread> workers;
+    for (int gen = GEN_2G; gen <= GEN_5G; ++gen) {
+        workers.emplace_back([this, gen, &captures, &writers]() {
+            io.beginCapture(&captures[gen]);
+            try {
+                runGeneration(static_cast<GenerationType>(gen), writers[gen].get());
+            } catch (const std::exception& e) {
+                io.errorstring(generationName(static_cast<GenerationType>(gen)));
+                io.errorstring(" Simulation Error: ");
+                io.errorstring(e.what());
+                io.terminate();
             }
+            io.endCapture();
+        });
+    }
+    for (auto& worker : workers) worker.join();
+    towerThreads = unlimited;
+
+    for (int gen = GEN_2G; gen <= GEN_5G; ++gen) {
+        io.replay(captures[gen]);
+        if (writers[gen]) {
+            writers[gen]->appendTo(*results);
+            results->flush();
         }
+    }
+    currentTower = generationTowers[GEN_5G];
+    currentGeneration = GEN_5G;
+}
+
+// ============================================================================
+// 2G Simulation
+// ============================================================================
+void CellularNetworkSimulator::run2G(ResultWriter* writer) {
+    io.outputstring("\n========== 2G COMMUNICATION SIMULATION ==========");
+    io.terminate();
+
+    try {
+        std::shared_ptr<CellTower> tower = createTower(GEN_2G);
+
+        io.outputstring("Technology: TDMA (Time Division Multiple Access)");
+        io.terminate();
+        io.outputstring("Bandwidth: ");
+        outputBandwidth(tower->getTotalBandwidth());
+        io.terminate();
+        outputChannelLayout(*tower);
+        io.outputstring("Messages per user: 20 (5 data + 15 voice)");
+        io.terminate();
+        tower->displayTrafficMix();
+        tower->displayPlacement();
+
+        tower->displayTotalCapacity();
 
-        currentTower->displayFirstChannelUsers();
+        outputAddingFirstChannel(*tower, "");
+        tower->populate();
 
-        // prompt for overhead per 100 messages (default 0)
-        io.outputstring("\nEnter overhead per 100 messages (0-100) [default 0]: ");
-        char buf[32] = {0};
-        io.inputstring(buf, 32);
-        int overhead = atoi(buf);
-        if (buf[0] == '\0') overhead = 0;
-        if (overhead < 0) overhead = 0;
+        tower->displayFirstChannelUsers();
 
-        currentTower->displayCoresNeeded(20, overhead);
+        int overhead = readOverhead();
+        analyseTower(*tower, writer, 20, overhead);
 
     } catch (const NetworkException& e) {
         io.errorstring("2G Simulation Error: ");
@@ -180,63 +1523,33 @@ void CellularNetworkSimulator::simulate2G() {
 // ============================================================================
 // 3G Simulation
 // ============================================================================
-void CellularNetworkSimulator::simulate3G() {
+void CellularNetworkSimulator::run3G(ResultWriter* writer) {
     io.outputstring("\n========== 3G COMMUNICATION SIMULATION ==========");
     io.terminate();
 
     try {
-        currentTower = std::make_shared<Tower3G>();
-        currentGeneration = GEN_3G;
-
-        int totalCapacity = currentTower->getTotalCapacity();
+        std::shared_ptr<CellTower> tower = createTower(GEN_3G);
 
         io.outputstring("Technology: CDMA (Code Division Multiple Access)");
         io.terminate();
-        io.outputstring("Bandwidth: 1 MHz (1000 kHz)");
-        io.terminate();
-        io.outputstring("Channel bandwidth: 200 kHz");
-        io.terminate();
-        io.outputstring("Number of channels: ");
-        io.outputint(1000 / 200);
-        io.terminate();
-        io.outputstring("Users per channel: 32");
+        io.outputstring("Bandwidth: ");
+        outputBandwidth(tower->getTotalBandwidth());
         io.terminate();
+        outputChannelLayout(*tower);
         io.outputstring("Messages per user: 10");
         io.terminate();
+        tower->displayTrafficMix();
+        tower->displayPlacement();
 
-        currentTower->displayTotalCapacity();
+        tower->displayTotalCapacity();
 
-        io.outputstring("\nAdding users to first channel (0-200 kHz)...");
-        io.terminate();
+        outputAddingFirstChannel(*tower, "");
+        tower->populate();
 
-        int usersInFirstChannel = 32;
-        for (int i = 0; i < usersInFirstChannel; ++i) {
-            auto user = std::make_shared<User3G>(i, 0);
-            currentTower->addUser(user);
-        }
+        tower->displayFirstChannelUsers();
 
-        int channelId = 1;
-        int usersInChannel = 0;
-        for (int i = usersInFirstChannel; i < totalCapacity; ++i) {
-            auto user = std::make_shared<User3G>(i, channelId);
-            currentTower->addUser(user);
-            usersInChannel++;
-            if (usersInChannel >= 32) {
-                channelId++;
-                usersInChannel = 0;
-            }
-        }
-
-        currentTower->displayFirstChannelUsers();
-
-        io.outputstring("\nEnter overhead per 100 messages (0-100) [default 0]: ");
-        char buf[32] = {0};
-        io.inputstring(buf, 32);
-        int overhead = atoi(buf);
-        if (buf[0] == '\0') overhead = 0;
-        if (overhead < 0) overhead = 0;
-
-        currentTower->displayCoresNeeded(10, overhead);
+        int overhead = readOverhead();
+        analyseTower(*tower, writer, 10, overhead);
 
     } catch (const NetworkException& e) {
         io.errorstring("3G Simulation Error: ");
@@ -248,87 +1561,38 @@ void CellularNetworkSimulator::simulate3G() {
 // ============================================================================
 // 4G Simulation
 // ============================================================================
-void CellularNetworkSimulator::simulate4G() {
+void CellularNetworkSimulator::run4G(ResultWriter* writer) {
     io.outputstring("\n========== 4G COMMUNICATION SIMULATION ==========");
     io.terminate();
 
     try {
-        currentTower = std::make_shared<Tower4G>();
-        currentGeneration = GEN_4G;
-
-        // prompt and set antennas (1..4)
-        io.outputstring("Enter number of antennas for 4G (1-4) [default 4]: ");
-        char buf[32] = {0};
-        io.inputstring(buf, 32);
-        int antennas = atoi(buf);
-        if (buf[0] == '\0') antennas = 4;
-        if (antennas < 1 || antennas > 4) antennas = 4;
-        currentTower->setNumAntennas(antennas);
+        std::shared_ptr<CellTower> tower = createTower(GEN_4G);
 
-        int totalCapacity = currentTower->getTotalCapacity();
+        tower->setNumAntennas(readAntennas("4G", towerConfigs[GEN_4G].numAntennas));
 
         io.outputstring("Technology: OFDM (Orthogonal Frequency Division Multiplexing)");
         io.terminate();
-        io.outputstring("Bandwidth: 1 MHz (1000 kHz)");
-        io.terminate();
-        io.outputstring("Channel bandwidth: 10 kHz");
-        io.terminate();
-        io.outputstring("Number of channels: ");
-        io.outputint(1000 / 10);
-        io.terminate();
-        io.outputstring("Users per channel: 30");
+        io.outputstring("Bandwidth: ");
+        outputBandwidth(tower->getTotalBandwidth());
         io.terminate();
+        outputChannelLayout(*tower);
         io.outputstring("Number of antennas: ");
-        io.outputint(currentTower->getNumAntennas());
+        io.outputint(tower->getNumAntennas());
         io.terminate();
         io.outputstring("Messages per user: 10");
         io.terminate();
+        tower->displayTrafficMix();
+        tower->displayPlacement();
 
-        currentTower->displayTotalCapacity();
-
-        io.outputstring("\nAdding users to first channel (0-10 kHz, Antenna 0)...");
-        io.terminate();
-
-        int usersInFirstChannel = 30;
-        for (int i = 0; i < usersInFirstChannel; ++i) {
-            auto user = std::make_shared<User4G>(i, 0, 0);
-            currentTower->addUser(user);
-        }
-
-        int userId = usersInFirstChannel;
-
-        // fill remaining channels for antenna 0
-        for (int channel = 1; channel < 100; ++channel) {
-            for (int u = 0; u < 30; ++u) {
-                if (userId < totalCapacity) {
-                    auto user = std::make_shared<User4G>(userId++, channel, 0);
-                    currentTower->addUser(user);
-                }
-            }
-        }
-
-        // fill other antenna layers (reuse)
-        for (int antenna = 1; antenna < currentTower->getNumAntennas(); ++antenna) {
-            for (int channel = 0; channel < 100; ++channel) {
-                for (int u = 0; u < 30; ++u) {
-                    if (userId < totalCapacity) {
-                        auto user = std::make_shared<User4G>(userId++, channel, antenna);
-                        currentTower->addUser(user);
-                    }
-                }
-            }
-        }
+        tower->displayTotalCapacity();
 
-        currentTower->displayFirstChannelUsers();
+        outputAddingFirstChannel(*tower, ", Antenna 0");
+        tower->populate();
 
-        io.outputstring("\nEnter overhead per 100 messages (0-100) [default 0]: ");
-        char buf2[32] = {0};
-        io.inputstring(buf2, 32);
-        int overhead = atoi(buf2);
-        if (buf2[0] == '\0') overhead = 0;
-        if (overhead < 0) overhead = 0;
+        tower->displayFirstChannelUsers();
 
-        currentTower->displayCoresNeeded(10, overhead);
+        int overhead = readOverhead();
+        analyseTower(*tower, writer, 10, overhead);
 
     } catch (const NetworkException& e) {
         io.errorstring("4G Simulation Error: ");
@@ -340,98 +1604,54 @@ void CellularNetworkSimulator::simulate4G() {
 // ============================================================================
 // 5G Simulation
 // ============================================================================
-void CellularNetworkSimulator::simulate5G() {
+void CellularNetworkSimulator::run5G(ResultWriter* writer) {
     io.outputstring("\n========== 5G COMMUNICATION SIMULATION ==========");
     io.terminate();
 
     try {
-        currentTower = std::make_shared<Tower5G>();
-        currentGeneration = GEN_5G;
+        std::shared_ptr<CellTower> tower = createTower(GEN_5G);
 
-        // prompt antennas (1..16)
-        io.outputstring("Enter number of antennas for 5G (1-16) [default 16]: ");
-        char buf[32] = {0};
-        io.inputstring(buf, 32);
-        int antennas = atoi(buf);
-        if (buf[0] == '\0') antennas = 16;
-        if (antennas < 1 || antennas > 16) antennas = 16;
-        currentTower->setNumAntennas(antennas);
-
-        int totalCapacity = currentTower->getTotalCapacity();
+        tower->setNumAntennas(readAntennas("5G", towerConfigs[GEN_5G].numAntennas));
 
         io.outputstring("Technology: Massive MIMO + OFDM");
         io.terminate();
-        io.outputstring("Primary bandwidth: 1 MHz (1000 kHz)");
-        io.terminate();
-        io.outputstring("Additional bandwidth: 10 MHz at 1800 MHz");
-        io.terminate();
-        io.outputstring("Channel bandwidth (primary): 10 kHz");
+        io.outputstring("Primary bandwidth: ");
+        outputBandwidth(tower->getTotalBandwidth());
         io.terminate();
-        io.outputstring("Users per 1 MHz (1800 MHz band): 30");
+        if (tower->getNumExtraChannels() > 0) {
+            io.outputstring("Additional bandwidth: ");
+            outputBandwidthShort(tower->getExtraBandwidth());
+            io.outputstring(" at 1800 MHz");
+            io.terminate();
+        }
+        io.outputstring("Channel bandwidth (primary): ");
+        io.outputint(tower->getChannelBandwidth());
+        io.outputstring(" kHz");
         io.terminate();
+        if (tower->getNumExtraChannels() > 0) {
+            io.outputstring("Users per ");
+            outputBandwidthShort(tower->getExtraChannelBandwidth());
+            io.outputstring(" (1800 MHz band): ");
+            io.outputint(tower->getExtraUsersPerChannel());
+            io.terminate();
+        }
         io.outputstring("Number of antennas: ");
-        io.outputint(currentTower->getNumAntennas());
+        io.outputint(tower->getNumAntennas());
         io.terminate();
         io.outputstring("Messages per user: 10");
         io.terminate();
+        tower->displayTrafficMix();
+        tower->displayPlacement();
 
-        currentTower->displayTotalCapacity();
-
-        io.outputstring("\nAdding users to first channel (0-10 kHz, Antenna 0, Primary band)...");
-        io.terminate();
-
-        int usersInFirstChannel = 30;
-        for (int i = 0; i < usersInFirstChannel; ++i) {
-            auto user = std::make_shared<User5G>(i, 0, 0, 0); // band=0 primary
-            currentTower->addUser(user);
-        }
+        tower->displayTotalCapacity();
 
-        int userId = usersInFirstChannel;
+        outputAddingFirstChannel(*tower, ", Antenna 0, Primary band");
+        tower->populate();
 
-        // fill remaining primary-band channels (antenna 0)
-        for (int channel = 1; channel < 100; ++channel) {
-            for (int u = 0; u < 30; ++u) {
-                if (userId < totalCapacity) {
-                    auto user = std::make_shared<User5G>(userId++, channel, 0, 0);
-                    currentTower->addUser(user);
-                }
-            }
-        }
+        tower->displayFirstChannelUsers();
 
-        // fill primary-band across other antennas (reuse)
-        for (int antenna = 1; antenna < currentTower->getNumAntennas(); ++antenna) {
-            for (int channel = 0; channel < 100; ++channel) {
-                for (int u = 0; u < 30; ++u) {
-                    if (userId < totalCapacity) {
-                        auto user = std::make_shared<User5G>(userId++, channel, antenna, 0);
-                        currentTower->addUser(user);
-                    }
-                }
-            }
-        }
-
-        // fill the additional 10 MHz@1800MHz band: we treat each MHz as a "channel group"
-        for (int antenna = 0; antenna < currentTower->getNumAntennas(); ++antenna) {
-            for (int mhz_channel = 0; mhz_channel < 10; ++mhz_channel) {
-                for (int u = 0; u < 30; ++u) {
-                    if (userId < totalCapacity) {
-                        auto user = std::make_shared<User5G>(userId++, mhz_channel, antenna, 1); // band=1
-                        currentTower->addUser(user);
-                    }
-                }
-            }
-        }
-
-        currentTower->displayFirstChannelUsers();
-
-        io.outputstring("\nEnter overhead per 100 messages (0-100) [default 0]: ");
-        char buf3[32] = {0};
-        io.inputstring(buf3, 32);
-        int overhead = atoi(buf3);
-        if (buf3[0] == '\0') overhead = 0;
-        if (overhead < 0) overhead = 0;
-
-        currentTower->displayCoresNeeded(10, overhead);
+        int overhead = readOverhead();
+        analyseTower(*tower, writer, 10, overhead);
 
     } catch (const NetworkException& e) {
         io.errorstring("5G Simulation Error: ");
@@ -453,10 +1673,7 @@ void CellularNetworkSimulator::runSimulation() {
     io.outputstring("=================================================");
     io.terminate();
 
-    simulate2G();
-    simulate3G();
-    simulate4G();
-    simulate5G();
+    simulateAll();
 
     io.outputstring("\n=================================================");
     io.terminate();
@@ -3,6 +3,14 @@
 #define CELLULAR_NETWORK_H
 
 #include "basicIO.h"
+#include "LatencyHistogram.h"
+#include "OccupancyIndex.h"
+#include "PreemptionHeap.h"
+#include "UserPlacement.h"
+#include <algorithm>
+#include <atomic>
+#include <climits>
+#include <cstdint>
 #include <memory>
 #include <vector>
 #include <stdexcept>
@@ -39,6 +47,112 @@ enum GenerationType {
     GEN_5G
 };
 
+// messages each user generates per the project specification (2G: 5 data + 15 voice)
+inline int defaultMessagesPerUser(GenerationType gen) {
+    return gen == GEN_2G ? 20 : 10;
+}
+
+inline const char* generationName(GenerationType gen) {
+    switch (gen) {
+        case GEN_2G: return "2G";
+        case GEN_3G: return "3G";
+        case GEN_4G: return "4G";
+        case GEN_5G: return "5G";
+    }
+    return "unknown";
+}
+
+// ============================================================================
+// TRAFFIC PROFILES - per-user traffic classes
+// ============================================================================
+enum TrafficClass {
+    TRAFFIC_DATA,
+    TRAFFIC_VOICE,
+    TRAFFIC_VIDEO,
+    TRAFFIC_IOT,
+    TRAFFIC_CLASS_COUNT
+};
+
+inline const char* trafficClassName(TrafficClass cls) {
+    switch (cls) {
+        case TRAFFIC_DATA: return "data";
+        case TRAFFIC_VOICE: return "voice";
+        case TRAFFIC_VIDEO: return "video";
+        case TRAFFIC_IOT: return "iot";
+        default: break;
+    }
+    return "unknown";
+}
+
+struct TrafficProfile {
+    int messages;                 // messages per user
+    int overheadPer100Messages;   // class-specific signalling overhead, below 100
+
+    // Load of one message in hundredths of a message. Like the overhead entered
+    // at the prompt (CellTower::coresForMessages), the class overhead takes
+    // that share of a core's capacity: a message costs 100 / (100 - overhead).
+    uint32_t messageUnits() const {
+        return (uint32_t)((10000 + 99 - overheadPer100Messages) / (100 - overheadPer100Messages));
+    }
+    // load of one user in hundredths of a message
+    uint64_t loadUnits() const {
+        const uint64_t share = (uint64_t)(100 - overheadPer100Messages);
+        return ((uint64_t)messages * 10000 + share - 1) / share;
+    }
+
+    // Throws InvalidConfigurationException unless the values are non-negative,
+    // the overhead is below 100 and a user's load fits a 32-bit load slot.
+    void validate() const;
+
+    // data is the generation's nominal user (in 2G the specification's
+    // handset: 5 data + 15 voice messages) and voice a voice-only user (the
+    // 15 voice messages in 2G); video is heavier, IoT sends little but with a
+    // large signalling overhead
+    static TrafficProfile defaults(GenerationType gen, TrafficClass cls);
+};
+
+// Share of users per traffic class, in percent (sums to 100). Users are
+// assigned by device ID (id % 100 against the cumulative shares), so the
+// assignment is deterministic and can be counted in closed form.
+struct TrafficMix {
+    int percent[TRAFFIC_CLASS_COUNT];
+
+    static TrafficMix allData() { return {{100, 0, 0, 0}}; }
+    bool isAllData() const { return percent[TRAFFIC_DATA] == 100; }
+    TrafficClass classForId(long long deviceId) const;
+    // users of cls among IDs [firstId, firstId + count)
+    long long countInRange(TrafficClass cls, long long firstId, long long count) const;
+    void validate() const;
+};
+
+// ============================================================================
+// QOS CLASSES - admission priority, highest first
+// ============================================================================
+enum QosClass {
+    QOS_EMERGENCY,
+    QOS_VOICE,
+    QOS_BEST_EFFORT,
+    QOS_CLASS_COUNT
+};
+
+inline const char* qosClassName(QosClass cls) {
+    switch (cls) {
+        case QOS_EMERGENCY: return "emergency";
+        case QOS_VOICE: return "voice";
+        case QOS_BEST_EFFORT: return "best-effort";
+        default: break;
+    }
+    return "unknown";
+}
+
+// outcome of CellTower::admitUser
+struct AdmissionResult {
+    bool admitted;
+    long long slot;                // -1 when rejected
+    long long preemptedDeviceId;   // -1 when nobody was pre-empted
+    QosClass preemptedClass;
+};
+
 // ============================================================================
 // TEMPLATE CLASS - Template Requirement
 // ============================================================================
@@ -52,22 +166,24 @@ public:
     using const_iterator = typename std::vector<T>::const_iterator;
 
     void add(const T& item) { items.push_back(item); }
+    void reserve(long long count) { items.reserve(static_cast<size_t>(count)); }
+    void resize(long long count) { items.resize(static_cast<size_t>(count)); }
 
-    T& get(int index) {
-        if (index < 0 || index >= static_cast<int>(items.size())) {
+    T& get(long long index) {
+        if (index < 0 || index >= static_cast<long long>(items.size())) {
             throw NetworkException("Index out of bounds");
         }
         return items[index];
     }
 
-    const T& get(int index) const {
-        if (index < 0 || index >= static_cast<int>(items.size())) {
+    const T& get(long long index) const {
+        if (index < 0 || index >= static_cast<long long>(items.size())) {
             throw NetworkException("Index out of bounds");
         }
         return items[index];
     }
 
-    int size() const { return static_cast<int>(items.size()); }
+    long long size() const { return static_cast<long long>(items.size()); }
     void clear() { items.clear(); }
 
     iterator begin() { return items.begin(); }
@@ -82,26 +198,45 @@ public:
 // ============================================================================
 class UserDevice {
 protected:
-    int deviceId;
+    long long deviceId;
     int channelId;
     int antennaId;
+    int frequencyBand;  // 0 => primary band, 1 => additional band (e.g. 5G 1800 MHz)
+    TrafficClass trafficClass;
+    QosClass qosClass;
     bool isActive;
+    long long* deactivationCounter;   // the holding tower's count of users deactivated in place
 public:
-    UserDevice(int id, int channel = 0, int antenna = 0)
-        : deviceId(id), channelId(channel), antennaId(antenna), isActive(true) {}
+    UserDevice(long long id, int channel = 0, int antenna = 0, int band = 0)
+        : deviceId(id), channelId(channel), antennaId(antenna), frequencyBand(band),
+          trafficClass(TRAFFIC_DATA), qosClass(QOS_BEST_EFFORT), isActive(true),
+          deactivationCounter(nullptr) {}
 
     virtual ~UserDevice() {}
 
     virtual int getMessagesGenerated() const = 0;
 
-    int getDeviceId() const { return deviceId; }
+    long long getDeviceId() const { return deviceId; }
+    int getFrequencyBand() const { return frequencyBand; }
     int getChannelId() const { return channelId; }
     int getAntennaId() const { return antennaId; }
     bool getIsActive() const { return isActive; }
+    TrafficClass getTrafficClass() const { return trafficClass; }
+    QosClass getQosClass() const { return qosClass; }
 
+    // the owning tower's profile for this class decides the user's load
+    void setTrafficClass(TrafficClass cls) { trafficClass = cls; }
+    // set before the user is attached; the tower indexes users by class
+    void setQosClass(QosClass cls) { qosClass = cls; }
     void setChannelId(int channel) { channelId = channel; }
+    void setFrequencyBand(int band) { frequencyBand = band; }
     void setAntennaId(int antenna) { antennaId = antenna; }
-    void deactivate() { isActive = false; }
+    void deactivate() {
+        if (isActive && deactivationCounter) ++*deactivationCounter;
+        isActive = false;
+    }
+    // set by the tower holding the user, so it can reclaim users deactivated in place
+    void setDeactivationCounter(long long* counter) { deactivationCounter = counter; }
 };
 
 // 2G
@@ -110,8 +245,8 @@ private:
     int dataMessages;
     int voiceMessages;
 public:
-    User2G(int id, int channel = 0)
-        : UserDevice(id, channel, 0), dataMessages(5), voiceMessages(15) {}
+    User2G(long long id, int channel = 0, int antenna = 0, int band = 0)
+        : UserDevice(id, channel, antenna, band), dataMessages(5), voiceMessages(15) {}
 
     int getMessagesGenerated() const override {
         return dataMessages + voiceMessages;
@@ -126,8 +261,8 @@ class User3G : public UserDevice {
 private:
     int totalMessages;
 public:
-    User3G(int id, int channel = 0)
-        : UserDevice(id, channel, 0), totalMessages(10) {}
+    User3G(long long id, int channel = 0, int antenna = 0, int band = 0)
+        : UserDevice(id, channel, antenna, band), totalMessages(10) {}
 
     int getMessagesGenerated() const override {
         return totalMessages;
@@ -139,8 +274,8 @@ class User4G : public UserDevice {
 private:
     int totalMessages;
 public:
-    User4G(int id, int channel = 0, int antenna = 0)
-        : UserDevice(id, channel, antenna), totalMessages(10) {}
+    User4G(long long id, int channel = 0, int antenna = 0, int band = 0)
+        : UserDevice(id, channel, antenna, band), totalMessages(10) {}
 
     int getMessagesGenerated() const override {
         return totalMessages;
@@ -151,17 +286,14 @@ public:
 class User5G : public UserDevice {
 private:
     int totalMessages;
-    int frequencyBand;
 public:
     // band: 0 => primary OFDM band, 1 => the extra 10 MHz@1800MHz band
-    User5G(int id, int channel = 0, int antenna = 0, int band = 0)
-        : UserDevice(id, channel, antenna), totalMessages(10), frequencyBand(band) {}
+    User5G(long long id, int channel = 0, int antenna = 0, int band = 0)
+        : UserDevice(id, channel, antenna, band), totalMessages(10) {}
 
     int getMessagesGenerated() const override {
         return totalMessages;
     }
-
-    int getFrequencyBand() const { return frequencyBand; }
 };
 
 // ============================================================================
@@ -171,19 +303,24 @@ class CellularCore {
 private:
     int coreId;
     int overheadPer100Messages;
+    int baseMessagesCapacity;
     int maxMessagesSupported; // messages per core (after overhead)
+    uint64_t busyUntilNs;     // queueing model: when the core finishes its backlog
+    uint64_t assignedLoad;    // packed traffic, in hundredths of a message (see TrafficProfile)
 public:
-    CellularCore(int id, int overhead)
-        : coreId(id), overheadPer100Messages(overhead), maxMessagesSupported(0) {
+    CellularCore(int id, int overhead, int baseCapacity = 10000)
+        : coreId(id), overheadPer100Messages(overhead), baseMessagesCapacity(baseCapacity),
+          maxMessagesSupported(0), busyUntilNs(0), assignedLoad(0) {
         calculateMaxMessages();
     }
 
     void calculateMaxMessages() {
         // base messages capacity a core can handle (interpreted as messages per core)
-        int baseMessagesCapacity = 10000;
+        if (baseMessagesCapacity < 1) baseMessagesCapacity = 1;
         if (overheadPer100Messages < 0) overheadPer100Messages = 0;
-        // reduce effective messages the core can handle according to overhead
-        maxMessagesSupported = baseMessagesCapacity * 100 / (100 + overheadPer100Messages);
+        // overhead takes its share of the capacity (the model of CellTower::coresForMessages)
+        maxMessagesSupported = (int)((long long)baseMessagesCapacity * (100 - overheadPer100Messages) / 100);
+        if (maxMessagesSupported < 1) maxMessagesSupported = 1;
     }
 
     int getCoreId() const { return coreId; }
@@ -192,8 +329,95 @@ public:
     int getMaxMessages() const { return maxMessagesSupported; }
 
     int getOverhead() const { return overheadPer100Messages; }
+
+    // Queueing model: the core serves messages FIFO at getMaxMessages() per
+    // second, so overhead slows every message down. A message of class weight
+    // loadUnits / 100 (see TrafficProfile) takes proportionally longer.
+    uint64_t getServiceTimeNs(uint32_t loadUnits = 100) const {
+        return 1000000000ULL * loadUnits / 100 / (uint64_t)maxMessagesSupported;
+    }
+
+    // Latency (queueing delay + service time) of a message arriving at arrivalNs.
+    uint64_t processMessage(uint64_t arrivalNs, uint32_t loadUnits = 100) {
+        uint64_t start = busyUntilNs > arrivalNs ? busyUntilNs : arrivalNs;
+        busyUntilNs = start + getServiceTimeNs(loadUnits);
+        return busyUntilNs - arrivalNs;
+    }
+    void resetQueue() { busyUntilNs = 0; }
+
+    // traffic placed on this core by the core allocator
+    void assignLoad(uint64_t loadUnits) { assignedLoad += loadUnits; }
+    uint64_t getAssignedLoad() const { return assignedLoad; }
+    bool isOverloaded() const { return assignedLoad > (uint64_t)maxMessagesSupported * 100; }
+};
+
+// ============================================================================
+// CORE ALLOCATION - result of packing whole channels / antenna groups onto cores
+// ============================================================================
+enum CoreGranularity {
+    PACK_PER_CHANNEL,   // one item per (band, antenna, channel)
+    PACK_PER_ANTENNA    // one item per (band, antenna): all of its channels together,
+                        // unless they exceed a core; then per channel
+};
+
+inline const char* coreGranularityName(CoreGranularity granularity) {
+    return granularity == PACK_PER_ANTENNA ? "antenna" : "channel";
+}
+
+struct CoreAllocation {
+    CoreGranularity granularity;
+    long long items;                // non-empty channels / antenna groups packed
+    long long cores;
+    long long lowerBound;           // cores if items could be split (CellTower::calculateCoresForTraffic)
+    long long splitGroups;          // antenna groups packed by channel because they exceed a core
+    long long oversizedItems;       // channels bigger than one core, each on its own (overloaded) core
+    int maxMessagesPerCore;         // CellularCore::getMaxMessages()
+    unsigned long long totalLoad;   // hundredths of a message
+    int efficiencyPerMille;         // load served within capacity / (cores * capacity)
+    long long solveMicros;
+};
+
+// ============================================================================
+// STEERING POLICIES - how a multi-RAT site picks the layer for an arrival
+// ============================================================================
+enum SteeringPolicy {
+    STEER_BEST_GENERATION,   // newest generation the device supports that has room
+    STEER_LEAST_UTILISED,    // supported layer with the lowest share of capacity in use
+    STEER_FEWEST_CORES,      // supported layer whose provisioned cores still have room
+    STEERING_POLICY_COUNT
+};
+
+inline const char* steeringPolicyName(SteeringPolicy policy) {
+    switch (policy) {
+        case STEER_BEST_GENERATION: return "best-generation";
+        case STEER_LEAST_UTILISED: return "least-utilised";
+        case STEER_FEWEST_CORES: return "fewest-cores";
+        default: break;
+    }
+    return "unknown";
+}
+
+// ============================================================================
+// TOWER CONFIGURATION - runtime tower geometry (see TowerConfig.h for loading)
+// ============================================================================
+struct TowerConfig {
+    int totalBandwidth;          // primary band, in kHz
+    int channelBandwidth;        // primary band channel width, in kHz
+    int usersPerChannel;
+    int numAntennas;             // also the upper bound offered by the antenna prompt
+    int extraBandwidth;          // additional band (e.g. 5G @1800 MHz), in kHz; 0 = none
+    int extraChannelBandwidth;   // channel group width in the additional band, in kHz
+    int extraUsersPerChannel;    // users per additional-band channel group
+
+    // project specification values for each generation
+    static TowerConfig defaults(GenerationType gen);
+
+    // throws InvalidConfigurationException when the geometry is unusable
+    void validate() const;
 };
 
+class SimulationStats;
+
 // ============================================================================
 // CELL TOWER BASE CLASS
 // ============================================================================
@@ -205,46 +429,312 @@ protected:
     int usersPerChannel;
     int numAntennas;
     int numChannels;
+    int extraBandwidth;          // in kHz
+    int extraChannelBandwidth;   // in kHz
+    int extraUsersPerChannel;
+    int numExtraChannels;
     NetworkContainer<std::shared_ptr<UserDevice>> users;
     std::vector<CellularCore> cores;
+    OccupancyIndex occupancy;    // active users per (band, antenna, channel)
+
+    // slot bookkeeping for detach / reuse
+    struct Vacancy { int band; int antenna; int channel; };
+    std::vector<long long> freeSlots;   // null entries in users, reused first by addUser
+    std::vector<Vacancy> vacancies;     // cells that lost a user, refilled first by populate
+    long long activeUsers;
+    long long nextDeviceId;
+    long long nextLayoutPosition;       // population slots handed out so far
+    int compactionThresholdPercent;     // compact once this share of slots is free
+    long long deactivatedUsers;         // attached users deactivated through UserDevice::deactivate()
+
+    // lazy population: consecutive device IDs occupying consecutive layout
+    // positions, recorded instead of materialised (sorted by firstId)
+    struct LazyRange { long long firstId; long long count; long long firstPosition; };
+    std::vector<LazyRange> lazyRanges;
+    long long lazyUsers;
+    bool lazyPopulation;
+
+    // traffic: per-class profiles, the class mix for populated users, and the
+    // load of every slot (TrafficProfile::loadUnits, 0 for free slots) kept
+    // contiguous alongside users so the aggregate is one linear pass
+    TrafficProfile trafficProfiles[TRAFFIC_CLASS_COUNT];
+    TrafficMix trafficMix;
+    bool onlyDataUsers;                 // every user was created under an all-data mix
+    std::vector<uint32_t> slotLoad;     // fits: TrafficProfile::validate()
+    long long lazyClassUsers[TRAFFIC_CLASS_COUNT];
+    int populationThreads;              // 0 => one per hardware thread
+    SimulationStats* stats;             // populate() progress, optional (not owned)
+
+    // QoS admission control: materialised users by pre-emption order (lazily
+    // recorded users are best-effort and pre-empted newest first on their own)
+    bool admissionControl;
+    PreemptionHeap preemptionOrder;
+    long long admittedByClass[QOS_CLASS_COUNT];
+    long long preemptedByClass[QOS_CLASS_COUNT];   // by class of the pre-empted user
+    long long rejectedByClass[QOS_CLASS_COUNT];
+
+    // user placement: per-channel user counts are the nominal ones divided by
+    // the expected resource factor of the placement model
+    PlacementModel placement;
+    int nominalUsersPerChannel;
+    int nominalExtraUsersPerChannel;
+    uint32_t expectedFactorMilli;       // 1000 without placement
+    // getResourceFactorMilli() of the current users, 0 until computed; every
+    // change to the population clears it (atomic: const readers may race to fill it)
+    mutable std::atomic<uint32_t> resourceFactorMilli;
+    void invalidateResourceFactor() { resourceFactorMilli.store(0, std::memory_order_relaxed); }
+
+    // re-sizes the occupancy cube to the current layout and recounts users
+    void resetOccupancy();
+
+    // (band, antenna, channel) of the given population slot in fill order
+    void layoutCell(long long position, int& band, int& antenna, int& channel) const;
+    // as layoutCell, plus how many consecutive positions from here share the cell
+    long long layoutRun(long long position, int& band, int& antenna, int& channel) const;
+
+    void recordLazyRange(long long count);
+    // appends count users at the next layout positions, in parallel slices
+    void populateRange(long long count);
+
+    // populated user for a layout cell, with its traffic class from the mix
+    std::shared_ptr<UserDevice> createPopulatedUser(long long id, int channel, int antenna, int band) const;
+    // stores user in a free slot (or appends one) and records its load
+    long long placeUser(const std::shared_ptr<UserDevice>& user);
+    void refreshSlotLoads();
+
+    void releaseSlot(long long slot);
+    void compactIfFragmented();
+    // detaches users deactivated in place without compacting; returns how many
+    long long releaseInactiveSlots();
+    // capacity check for one more user, after reclaiming users deactivated in place
+    bool hasRoom();
+
+    // larger = pre-empted sooner: lowest priority class first, newest user first
+    static uint64_t preemptionKey(const UserDevice& user) {
+        return ((uint64_t)user.getQosClass() << 56) | ((uint64_t)user.getDeviceId() & ((1ULL << 56) - 1));
+    }
+    void rebuildPreemptionOrder();
+    // removes the newest lazily recorded user and reports its cell
+    void preemptLazyUser(int& band, int& antenna, int& channel);
+
+    // builds the generation-specific user device for one population slot
+    virtual std::shared_ptr<UserDevice> createUser(long long id, int channel, int antenna, int band) const = 0;
 public:
-    CellTower(GenerationType gen, int totalBW, int channelBW, int usersPerCh, int antennas)
-        : generation(gen), totalBandwidth(totalBW), channelBandwidth(channelBW),
-          usersPerChannel(usersPerCh), numAntennas(antennas) {
-        if (channelBandwidth <= 0) throw InvalidConfigurationException("channel bandwidth invalid");
+    CellTower(GenerationType gen, const TowerConfig& config)
+        : generation(gen), totalBandwidth(config.totalBandwidth),
+          channelBandwidth(config.channelBandwidth), usersPerChannel(config.usersPerChannel),
+          numAntennas(config.numAntennas), extraBandwidth(config.extraBandwidth),
+          extraChannelBandwidth(config.extraChannelBandwidth),
+          extraUsersPerChannel(config.extraUsersPerChannel), activeUsers(0), nextDeviceId(0),
+          nextLayoutPosition(0), compactionThresholdPercent(25), deactivatedUsers(0), lazyUsers(0),
+          lazyPopulation(false),
+          trafficMix(TrafficMix::allData()), onlyDataUsers(true), lazyClassUsers{0, 0, 0, 0},
+          populationThreads(0),
+          stats(nullptr),
+          admissionControl(false), admittedByClass{0, 0, 0}, preemptedByClass{0, 0, 0},
+          rejectedByClass{0, 0, 0}, placement(PLACEMENT_NONE), nominalUsersPerChannel(config.usersPerChannel),
+          nominalExtraUsersPerChannel(config.extraUsersPerChannel), expectedFactorMilli(1000),
+          resourceFactorMilli(0) {
+        config.validate();
+        for (int cls = 0; cls < TRAFFIC_CLASS_COUNT; ++cls) {
+            trafficProfiles[cls] = TrafficProfile::defaults(gen, static_cast<TrafficClass>(cls));
+        }
         numChannels = totalBandwidth / channelBandwidth;
-        if (numChannels < 0) numChannels = 0;
+        numExtraChannels = extraBandwidth > 0 ? extraBandwidth / extraChannelBandwidth : 0;
         if (numAntennas < 1) numAntennas = 1;
+        resetOccupancy();
     }
 
-    virtual ~CellTower() {}
-
-    virtual void addUser(std::shared_ptr<UserDevice> user) {
-        int totalCapacity = getTotalCapacity();
-        if (users.size() >= totalCapacity) {
-            throw CapacityExceededException();
+    virtual ~CellTower();
+
+    // users keep a pointer into their tower (UserDevice::setDeactivationCounter)
+    CellTower(const CellTower&) = delete;
+    CellTower& operator=(const CellTower&) = delete;
+
+    // Admits a user into a free slot (or appends one) and returns its slot index.
+    // Only attached users count toward capacity; when the tower is full, users
+    // deactivated in place are detached first and their slots reused (without
+    // compaction, so existing slot indices stay valid).
+    virtual long long addUser(std::shared_ptr<UserDevice> user);
+
+    // Fills population slots band by band, antenna by antenna, channel by channel,
+    // assigning consecutive device IDs, until the tower holds targetUsers users
+    // (default and upper bound: capacity). Users deactivated in place are
+    // detached first; cells vacated by detached users are refilled first.
+    // Fresh layout positions are filled in parallel: user k of the run gets
+    // ID nextDeviceId + k at position nextLayoutPosition + k, so slices cut at
+    // channel boundaries are created independently and the result is identical
+    // to a sequential fill.
+    void populate(long long targetUsers = -1);
+    void setPopulationThreads(int threads) { populationThreads = threads; }
+    // populate() reports the users it places to counters while it runs
+    void setStats(SimulationStats* counters) { stats = counters; }
+
+    // User placement within the cell (see UserPlacement). Must be set before
+    // the tower is populated: the expected resource factor of the model,
+    // measured over the IDs the tower will hand out first, scales the users
+    // per channel, and the actual factor of the active users scales the load
+    // behind the core counts. Throws InvalidConfigurationException otherwise.
+    void setPlacement(PlacementModel model);
+    PlacementModel getPlacement() const { return placement; }
+    uint32_t getExpectedResourceFactorMilli() const { return expectedFactorMilli; }
+    // mean resource factor of the active users, per mille (1000 without
+    // placement); computed once per population state and cached
+    uint32_t getResourceFactorMilli() const;
+    void displayPlacement() const;      // only when a placement model is set
+
+    // QoS admission: with admission control on, a user arriving at a full tower
+    // pre-empts the lowest-priority active user (newest first) if that user's
+    // class is strictly lower, taking over its channel; otherwise it is
+    // rejected. Admission and pre-emption are O(log n).
+    void setAdmissionControl(bool enabled);
+    bool hasAdmissionControl() const { return admissionControl; }
+    AdmissionResult admitUser(std::shared_ptr<UserDevice> user);
+    // a new, unattached user with the next device ID; placed in the most
+    // recently vacated cell if there is one, else at the next layout position
+    std::shared_ptr<UserDevice> createArrival(QosClass cls) const;
+    long long getAdmittedCount(QosClass cls) const { return admittedByClass[cls]; }
+    long long getPreemptedCount(QosClass cls) const { return preemptedByClass[cls]; }
+    long long getRejectedCount(QosClass cls) const { return rejectedByClass[cls]; }
+
+    // Deactivates the user in slot and frees the slot for reuse. Detaching may
+    // compact the user store, which renumbers slots; look users up again afterwards.
+    void detachUser(long long slot);
+    void detachUsers(const std::vector<long long>& slots);   // compacts at most once
+    // Detaches up to count users without looking them up: the newest lazily
+    // recorded users first (O(cells touched)), then materialised users from
+    // the last slot back. Returns how many were detached.
+    long long releaseUsers(long long count);
+    // detaches users that were deactivated directly through UserDevice::deactivate()
+    long long reclaimInactiveUsers();
+    // slot holding deviceId, or -1 (lazily recorded users have no slot until materialised)
+    long long findUserSlot(long long deviceId) const;
+
+    // With lazy population on, populate() records ID ranges per layout run
+    // instead of creating user objects; users are created on demand.
+    void setLazyPopulation(bool lazy) { lazyPopulation = lazy; }
+    bool isLazyPopulation() const { return lazyPopulation; }
+    long long getNumLazyUsers() const { return lazyUsers; }
+    // Slot of deviceId, creating the user object if it is only recorded lazily; -1 if unknown.
+    long long materialiseUser(long long deviceId);
+    // messages generated by a user of this generation (used for lazily recorded users)
+    int getDefaultUserMessages() const;
+
+    // Traffic profiles apply to every user, including ones already attached.
+    // The mix decides the class of users created by populate() from now on.
+    void setTrafficProfile(TrafficClass cls, const TrafficProfile& profile);
+    const TrafficProfile& getTrafficProfile(TrafficClass cls) const { return trafficProfiles[cls]; }
+    void setTrafficMix(const TrafficMix& mix);
+    const TrafficMix& getTrafficMix() const { return trafficMix; }
+    TrafficClass getTrafficClassOf(long long deviceId) const { return trafficMix.classForId(deviceId); }
+    long long getNumUsersInClass(TrafficClass cls) const;
+
+    // total load of all attached users, in hundredths of a message
+    unsigned long long getTrafficLoad() const;
+
+    // Visits every attached user as runs of consecutive IDs sharing one cell:
+    // visit(firstId, count, channel, antenna, band, device), in device ID
+    // order. Materialised users are one run each with their device; lazy runs
+    // pass a null device.
+    template <typename RunVisitor>
+    void forEachUserRun(RunVisitor visit) const {
+        // materialised users sorted by ID, merged with the (sorted) lazy ranges
+        std::vector<std::pair<long long, long long>> byId;   // (device ID, slot)
+        byId.reserve((size_t)(users.size() - (long long)freeSlots.size()));
+        for (long long slot = 0; slot < users.size(); ++slot) {
+            const auto& user = users.get(slot);
+            if (user) byId.push_back({user->getDeviceId(), slot});
+        }
+        if (!std::is_sorted(byId.begin(), byId.end())) std::sort(byId.begin(), byId.end());
+
+        size_t next = 0;
+        auto visitMaterialisedBefore = [&](long long id) {
+            for (; next < byId.size() && byId[next].first < id; ++next) {
+                const UserDevice* user = users.get(byId[next].second).get();
+                visit(user->getDeviceId(), 1LL, user->getChannelId(), user->getAntennaId(),
+                      user->getFrequencyBand(), user);
+            }
+        };
+        for (const LazyRange& range : lazyRanges) {
+            visitMaterialisedBefore(range.firstId);
+            long long done = 0;
+            while (done < range.count) {
+                int band, antenna, channel;
+                long long run = layoutRun(range.firstPosition + done, band, antenna, channel);
+                if (run > range.count - done) run = range.count - done;
+                visit(range.firstId + done, run, channel, antenna, band, (const UserDevice*)nullptr);
+                done += run;
+            }
         }
-        users.add(user);
+        visitMaterialisedBefore(LLONG_MAX);
     }
 
-    virtual int getTotalCapacity() const {
-        return numChannels * usersPerChannel * numAntennas;
+    void compact();
+    void setCompactionThreshold(int percent) { compactionThresholdPercent = percent; }
+    long long getNumFreeSlots() const { return (long long)freeSlots.size(); }
+
+    virtual long long getTotalCapacity() const {
+        long long primary = (long long)numChannels * usersPerChannel * numAntennas;
+        long long extra = (long long)numExtraChannels * extraUsersPerChannel * numAntennas;
+        return primary + extra;
     }
 
+    // Packs the traffic of whole channels (or antenna groups) onto CellularCore
+    // instances of this generation, first fit decreasing, never splitting an
+    // item. Replaces the tower's cores (see getCores()).
+    CoreAllocation allocateCores(int overheadPer100Messages, CoreGranularity granularity);
+    const std::vector<CellularCore>& getCores() const { return cores; }
+
     // core calc and displays - updated to accept overhead parameter
-    virtual int calculateCoresNeeded(int messagesPerUser, int overheadPer100Messages = 0) const;
+    virtual long long calculateCoresNeeded(int messagesPerUser, int overheadPer100Messages = 0) const;
+    // as calculateCoresNeeded, but from the per-user traffic profiles
+    long long calculateCoresForTraffic(int overheadPer100Messages = 0) const;
+    // cores a generation needs for totalMessages at the given extra overhead
+    static long long coresForMessages(GenerationType gen, long long totalMessages, int overheadPer100Messages);
+    // messages per second one core of the generation handles before overhead
+    static long long baseMessagesPerCore(GenerationType gen);
+
+    // Queueing simulation of one second of this tower's traffic on the cores
+    // calculateCoresForTraffic(overhead) provisions: Poisson arrivals per core,
+    // FIFO service on CellularCore, per-message latency recorded in ns. Cores
+    // are simulated on up to `threads` workers (0 = hardware threads); each core
+    // has its own random stream, so results do not depend on the thread count.
+    // Returns the number of cores simulated.
+    long long simulateMessageLatency(int overheadPer100Messages, LatencyHistogram& histogram,
+                                     int threads = 0) const;
     virtual void displayFirstChannelUsers() const;
     void displayTotalCapacity() const;
     void displayCoresNeeded(int messagesPerUser, int overheadPer100Messages = 0) const;
+    void displayTrafficCoresNeeded(int overheadPer100Messages = 0) const;
+    void displayTrafficMix() const;   // only when the mix is not all-data
 
-    int getNumUsers() const { return users.size(); }
+    long long getNumUsers() const { return activeUsers; }
     GenerationType getGeneration() const { return generation; }
 
     int getNumAntennas() const { return numAntennas; }
-    void setNumAntennas(int antennas) {
-        if (antennas < 1) antennas = 1;
-        numAntennas = antennas;
-    }
+    int getNumChannels() const { return numChannels; }
+    int getUsersPerChannel() const { return usersPerChannel; }
+    int getTotalBandwidth() const { return totalBandwidth; }
+    int getChannelBandwidth() const { return channelBandwidth; }
+    int getExtraBandwidth() const { return extraBandwidth; }
+    int getExtraChannelBandwidth() const { return extraChannelBandwidth; }
+    int getExtraUsersPerChannel() const { return extraUsersPerChannel; }
+    int getNumExtraChannels() const { return numExtraChannels; }
+    int getNumBands() const { return numExtraChannels > 0 ? 2 : 1; }
+    int getChannelsInBand(int band) const { return band == 0 ? numChannels : numExtraChannels; }
+    int getUsersPerChannelInBand(int band) const { return band == 0 ? usersPerChannel : extraUsersPerChannel; }
+    // Users' cells follow the layout, which depends on the antenna count, so
+    // this throws InvalidConfigurationException once the tower is populated.
+    void setNumAntennas(int antennas);
+
+    // O(1) range counts and top-k saturated channels over this tower's users
+    const OccupancyIndex& getOccupancy() const { return occupancy; }
+    // for the occupancy recorder, which reads the changed cells and then clears them
+    void setOccupancyTracking(bool on) { occupancy.setChangeTracking(on); }
+    void clearOccupancyChanges() { occupancy.clearChanges(); }
+
+    // factory for the tower class matching a generation
+    static std::shared_ptr<CellTower> create(GenerationType gen, const TowerConfig& config);
 
     const NetworkContainer<std::shared_ptr<UserDevice>>& getUsers() const { return users; }
     NetworkContainer<std::shared_ptr<UserDevice>>& getUsersMutable() { return users; }
@@ -252,41 +742,46 @@ public:
 
 // 2G Tower
 class Tower2G : public CellTower {
+protected:
+    std::shared_ptr<UserDevice> createUser(long long id, int channel, int antenna, int band) const override {
+        return std::make_shared<User2G>(id, channel, antenna, band);
+    }
 public:
-    Tower2G() : CellTower(GEN_2G, 1000, 200, 16, 1) {}
+    Tower2G() : CellTower(GEN_2G, TowerConfig::defaults(GEN_2G)) {}
+    explicit Tower2G(const TowerConfig& config) : CellTower(GEN_2G, config) {}
 };
 
 // 3G Tower
 class Tower3G : public CellTower {
+protected:
+    std::shared_ptr<UserDevice> createUser(long long id, int channel, int antenna, int band) const override {
+        return std::make_shared<User3G>(id, channel, antenna, band);
+    }
 public:
-    Tower3G() : CellTower(GEN_3G, 1000, 200, 32, 1) {}
+    Tower3G() : CellTower(GEN_3G, TowerConfig::defaults(GEN_3G)) {}
+    explicit Tower3G(const TowerConfig& config) : CellTower(GEN_3G, config) {}
 };
 
 // 4G Tower
 class Tower4G : public CellTower {
+protected:
+    std::shared_ptr<UserDevice> createUser(long long id, int channel, int antenna, int band) const override {
+        return std::make_shared<User4G>(id, channel, antenna, band);
+    }
 public:
-    Tower4G() : CellTower(GEN_4G, 1000, 10, 30, 4) {}
+    Tower4G() : CellTower(GEN_4G, TowerConfig::defaults(GEN_4G)) {}
+    explicit Tower4G(const TowerConfig& config) : CellTower(GEN_4G, config) {}
 };
 
-// 5G Tower — with additional 10 MHz band @1800 MHz
+// 5G Tower — with additional 10 MHz band @1800 MHz (the config's extra band)
 class Tower5G : public CellTower {
-private:
-    int additionalBandwidth; // in kHz (10 MHz = 10000 kHz)
-    int usersPerMHz;
-public:
-    Tower5G() : CellTower(GEN_5G, 1000, 10, 30, 16),
-                additionalBandwidth(10000), usersPerMHz(30) {}
-
-    int getTotalCapacity() const override {
-        int originalBandChannels = totalBandwidth / channelBandwidth;
-        int originalBandCapacity = originalBandChannels * usersPerChannel * numAntennas;
-
-        // additionalBandwidth is in kHz; usersPerMHz is per 1 MHz
-        int additionalMHz = additionalBandwidth / 1000;
-        int additionalBandCapacity = additionalMHz * usersPerMHz * numAntennas;
-
-        return originalBandCapacity + additionalBandCapacity;
+protected:
+    std::shared_ptr<UserDevice> createUser(long long id, int channel, int antenna, int band) const override {
+        return std::make_shared<User5G>(id, channel, antenna, band);
     }
+public:
+    Tower5G() : CellTower(GEN_5G, TowerConfig::defaults(GEN_5G)) {}
+    explicit Tower5G(const TowerConfig& config) : CellTower(GEN_5G, config) {}
 
     void displayFirstChannelUsers() const override;
 };
@@ -294,17 +789,128 @@ public:
 // ============================================================================
 // CELLULAR NETWORK SIMULATOR
 // ============================================================================
+class ResultWriter;
+class ScenarioCache;
+
 class CellularNetworkSimulator {
 private:
     std::shared_ptr<CellTower> currentTower;
     GenerationType currentGeneration;
+    std::shared_ptr<CellTower> generationTowers[4];  // latest tower per generation
+    TowerConfig towerConfigs[4];  // indexed by GenerationType
+    ResultWriter* results;      // optional structured output (not owned)
+    bool includeUserRows;       // dump one result row per user
+    int saturatedCells;         // top-k saturated cell records per tower (0 = none)
+    int saturationPercent;      // ... at or above this share of users per channel
+    bool lazyPopulation;        // record user ranges instead of creating every user
+    bool parallelAll;           // run "Simulate ALL" generations concurrently
+    TrafficMix trafficMix;
+    TrafficProfile trafficOverrides[TRAFFIC_CLASS_COUNT];   // messages < 0 => generation default
+    bool latencyReport;         // run the queueing model after each core count
+    std::unique_ptr<LatencyHistogram> generationLatency[4];   // merged over every tower simulated
+    ScenarioCache* scenarioCache;   // optional memoised results (not owned)
+    SimulationStats* stats;         // optional live counters (not owned)
+    bool corePacking;               // also pack whole channels / antenna groups onto cores
+    CoreGranularity packingGranularity;
+    long long overloadArrivals;     // QoS admission run per tower after the analysis (0 = off)
+    PlacementModel placement;       // user placement applied to every tower created
+    int towerThreads;               // population / latency workers per tower (0 = hardware threads)
+
+    // One generation's simulation. Touches only generationTowers[gen] and writer,
+    // so different generations can run on different threads.
+    void runGeneration(GenerationType gen, ResultWriter* writer);
+    void run2G(ResultWriter* writer);
+    void run3G(ResultWriter* writer);
+    void run4G(ResultWriter* writer);
+    void run5G(ResultWriter* writer);
+    std::shared_ptr<CellTower> createTower(GenerationType gen);
+
+    void writeResults(const CellTower& tower, ResultWriter* writer,
+                      int messagesPerUser, int overheadPer100Messages, long long cores,
+                      const LatencyHistogram* latency, const CoreAllocation* allocation) const;
+    void simulateAllParallel();
+    // prints a tower's latency percentiles and adds them to its generation
+    void reportLatency(GenerationType gen, const LatencyHistogram& histogram, long long cores);
+    void analyseTower(CellTower& tower, ResultWriter* writer, int messagesPerUser,
+                      int overheadPer100Messages);
+    void reportCorePacking(const CoreAllocation& allocation) const;
+    void runOverload(CellTower& tower) const;
 public:
-    CellularNetworkSimulator() : currentTower(nullptr), currentGeneration(GEN_2G) {}
+    CellularNetworkSimulator()
+        : currentTower(nullptr), currentGeneration(GEN_2G),
+          towerConfigs{TowerConfig::defaults(GEN_2G), TowerConfig::defaults(GEN_3G),
+                       TowerConfig::defaults(GEN_4G), TowerConfig::defaults(GEN_5G)},
+          results(nullptr), includeUserRows(false), saturatedCells(0), saturationPercent(0),
+          lazyPopulation(false), parallelAll(false),
+          trafficMix(TrafficMix::allData()), trafficOverrides{{-1, 0}, {-1, 0}, {-1, 0}, {-1, 0}},
+          latencyReport(false), scenarioCache(nullptr), stats(nullptr), corePacking(false),
+          packingGranularity(PACK_PER_CHANNEL), overloadArrivals(0), placement(PLACEMENT_NONE),
+          towerThreads(0) {}
+
+    void setResultWriter(ResultWriter* writer, bool userRows = false) {
+        results = writer;
+        includeUserRows = userRows;
+    }
+    // With results on, also write each tower's k fullest cells at or above
+    // thresholdPercent of their users-per-channel limit.
+    void setSaturatedCellReport(int k, int thresholdPercent) {
+        saturatedCells = k;
+        saturationPercent = thresholdPercent;
+    }
 
-    void simulate2G();
-    void simulate3G();
-    void simulate4G();
-    void simulate5G();
+    void setTowerConfig(GenerationType gen, const TowerConfig& config) {
+        config.validate();
+        towerConfigs[gen] = config;
+    }
+    const TowerConfig& getTowerConfig(GenerationType gen) const { return towerConfigs[gen]; }
+    // A new tower of gen with the simulator's tower settings applied: geometry,
+    // lazy population, traffic mix and profiles, placement. Also used by the
+    // sharded workers, so both modes model the same towers.
+    std::shared_ptr<CellTower> configureTower(GenerationType gen) const;
+
+    void setLazyPopulation(bool lazy) { lazyPopulation = lazy; }
+
+    // Run the four generations of simulateAll() on separate threads. Output is
+    // buffered per generation and printed in 2G..5G order, byte-identical to
+    // the sequential run; interactive answers are read up front.
+    void setParallelAll(bool parallel) { parallelAll = parallel; }
+
+    // applied to every tower created from now on
+    void setTrafficMix(const TrafficMix& mix) {
+        mix.validate();
+        trafficMix = mix;
+    }
+    void setTrafficProfile(TrafficClass cls, const TrafficProfile& profile) { trafficOverrides[cls] = profile; }
+
+    // Report p50/p99/p99.9 message latency for every simulated tower, and per
+    // generation (merged over all its towers) after "Simulate ALL".
+    void setLatencyReport(bool enabled);
+
+    // Serve core counts and latency of previously analysed scenarios from
+    // cache (towers are then populated lazily). Must outlive the simulator's use.
+    void setScenarioCache(ScenarioCache* cache) { scenarioCache = cache; }
+    void setStats(SimulationStats* counters) { stats = counters; }
+    SimulationStats* getStats() const { return stats; }
+
+    // After the core count, report the cores needed when channels (or antenna
+    // groups) cannot be split across cores (CellTower::allocateCores).
+    void setCorePacking(bool enabled, CoreGranularity granularity = PACK_PER_CHANNEL) {
+        corePacking = enabled;
+        packingGranularity = granularity;
+    }
+    // After each tower is analysed, offer it this many extra users under QoS
+    // admission control.
+    void setOverloadArrivals(long long arrivals) { overloadArrivals = arrivals; }
+    // User placement model applied to every tower created from now on.
+    void setPlacement(PlacementModel model) { placement = model; }
+    void displayLatencySummary() const;
+
+    void simulateGeneration(GenerationType gen);
+    void simulate2G() { simulateGeneration(GEN_2G); }
+    void simulate3G() { simulateGeneration(GEN_3G); }
+    void simulate4G() { simulateGeneration(GEN_4G); }
+    void simulate5G() { simulateGeneration(GEN_5G); }
+    void simulateAll();
     void runSimulation();
 };
 
@@ -0,0 +1,112 @@
+// CoreAllocator.cpp
+#include "CoreAllocator.h"
+#include <algorithm>
+#include <utility>
+
+// max segment tree over remaining capacity; leaves are cores in index order
+class RemainingCapacityTree {
+private:
+    size_t leaves;
+    std::vector<uint64_t> best;   // best[1] is the root; leaf i at best[leaves + i]
+
+public:
+    RemainingCapacityTree(size_t cores, uint64_t capacity) : leaves(1) {
+        while (leaves < cores) leaves <<= 1;
+        best.assign(2 * leaves, 0);
+        for (size_t i = 0; i < cores; ++i) best[leaves + i] = capacity;
+        for (size_t node = leaves - 1; node >= 1; --node) best[node] = std::max(best[2 * node], best[2 * node + 1]);
+    }
+
+    // leftmost core with at least size remaining, or -1
+    long long firstFit(uint64_t size) const {
+        if (best[1] < size) return -1;
+        size_t node = 1;
+        while (node < leaves) node = best[2 * node] >= size ? 2 * node : 2 * node + 1;
+        return (long long)(node - leaves);
+    }
+
+    uint64_t remaining(size_t core) const { return best[leaves + core]; }
+
+    void set(size_t core, uint64_t value) {
+        size_t node = leaves + core;
+        best[node] = value;
+        for (node >>= 1; node >= 1; node >>= 1) {
+            uint64_t updated = std::max(best[2 * node], best[2 * node + 1]);
+            if (best[node] == updated) break;   // nothing changes further up
+            best[node] = updated;
+        }
+    }
+};
+
+// Stable LSD radix sort by decreasing size, 11 bits per pass and only as many
+// passes as the largest size needs; ties keep their input order.
+static void sortDecreasing(std::vector<std::pair<uint64_t, uint32_t>>& items) {
+    if (items.size() < 2) return;
+    uint64_t largest = 0;
+    for (const auto& item : items) largest = std::max(largest, item.first);
+
+    const int DIGIT_BITS = 11;
+    const size_t BUCKETS = (size_t)1 << DIGIT_BITS;
+    std::vector<std::pair<uint64_t, uint32_t>> scratch(items.size());
+    std::vector<size_t> start(BUCKETS);
+    for (int shift = 0; shift < 64 && (largest >> shift) != 0; shift += DIGIT_BITS) {
+        // digits of (largest - size) ascending == sizes descending
+        std::fill(start.begin(), start.end(), 0);
+        for (const auto& item : items) ++start[((largest - item.first) >> shift) & (BUCKETS - 1)];
+        size_t offset = 0;
+        for (size_t& bucket : start) {
+            size_t count = bucket;
+            bucket = offset;
+            offset += count;
+        }
+        for (const auto& item : items) scratch[start[((largest - item.first) >> shift) & (BUCKETS - 1)]++] = item;
+        items.swap(scratch);
+    }
+}
+
+CoreAllocator::Packing CoreAllocator::firstFitDecreasing(const std::vector<uint64_t>& sizes, uint64_t capacity) {
+    Packing packing;
+    packing.coreOf.assign(sizes.size(), -1);
+    packing.oversizedItems = 0;
+
+    // non-empty items by decreasing size (ties in input order)
+    std::vector<std::pair<uint64_t, uint32_t>> order;
+    order.reserve(sizes.size());
+    uint64_t total = 0;
+    size_t oversized = 0;
+    for (size_t item = 0; item < sizes.size(); ++item) {
+        if (sizes[item] == 0) continue;
+        order.push_back({sizes[item], (uint32_t)item});
+        total += sizes[item];
+        if (sizes[item] > capacity) ++oversized;
+    }
+    sortDecreasing(order);
+
+    // First fit never leaves two cores at most half full, so it opens fewer
+    // than 2 * ceil(total / capacity) + 1 cores (plus one per oversized item).
+    // Unopened cores sit to the right of the opened ones.
+    size_t bound = capacity > 0 ? (size_t)(2 * ((total + capacity - 1) / capacity) + 1) + oversized : order.size();
+    if (bound > order.size()) bound = order.size();
+    RemainingCapacityTree tree(bound > 0 ? bound : 1, capacity);
+    size_t opened = 0;
+    for (const auto& entry : order) {
+        const uint64_t size = entry.first;
+        const uint32_t item = entry.second;
+
+        long long core = size <= capacity ? tree.firstFit(size) : -1;
+        if (core < 0) {
+            core = (long long)opened;   // oversized: a dedicated core, left full
+            ++packing.oversizedItems;
+            tree.set((size_t)core, 0);
+        } else {
+            tree.set((size_t)core, tree.remaining((size_t)core) - size);
+        }
+        if ((size_t)core == opened) {
+            ++opened;
+            packing.coreLoad.push_back(0);
+        }
+        packing.coreLoad[(size_t)core] += size;
+        packing.coreOf[item] = (int)core;
+    }
+    return packing;
+}
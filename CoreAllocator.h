@@ -0,0 +1,28 @@
+// CoreAllocator.h
+#ifndef CORE_ALLOCATOR_H
+#define CORE_ALLOCATOR_H
+
+#include <cstdint>
+#include <vector>
+
+// ============================================================================
+// CORE ALLOCATOR
+// First-fit-decreasing bin packing of indivisible traffic items (channels or
+// antenna groups) onto equal-capacity cores. Items are sorted by size, then
+// each goes to the lowest-numbered core with enough room, found in O(log n)
+// with a max segment tree over the cores' remaining capacity. FFD never uses
+// more than 11/9 OPT + 6/9 cores.
+// ============================================================================
+class CoreAllocator {
+public:
+    struct Packing {
+        std::vector<int> coreOf;          // per item, in input order
+        std::vector<uint64_t> coreLoad;   // per opened core
+        long long oversizedItems;         // larger than one core; each got a core of its own
+    };
+
+    // sizes and capacity in the same unit; zero-size items are left unassigned (-1)
+    static Packing firstFitDecreasing(const std::vector<uint64_t>& sizes, uint64_t capacity);
+};
+
+#endif // CORE_ALLOCATOR_H
@@ -0,0 +1,94 @@
+// LatencyHistogram.cpp
+#include "LatencyHistogram.h"
+
+static const int HALF_SUB_BUCKETS = 1 << (LatencyHistogram::SUB_BUCKET_BITS - 1);
+
+// values below 2^SUB_BUCKET_BITS map to themselves; above that, the shift
+// that brings the value into [HALF, 2 * HALF) selects the group and the
+// shifted value the linear sub-bucket inside it
+int LatencyHistogram::bucketIndex(uint64_t value) {
+    if (value > MAX_TRACKABLE) value = MAX_TRACKABLE;
+    if (value < (1ULL << SUB_BUCKET_BITS)) return (int)value;
+    int msb = 63 - __builtin_clzll(value);
+    int shift = msb - (SUB_BUCKET_BITS - 1);
+    return shift * HALF_SUB_BUCKETS + (int)(value >> shift);
+}
+
+uint64_t LatencyHistogram::bucketHighestValue(int index) {
+    if (index < (1 << SUB_BUCKET_BITS)) return (uint64_t)index;
+    int shift = index / HALF_SUB_BUCKETS - 1;
+    uint64_t mantissa = (uint64_t)(index - shift * HALF_SUB_BUCKETS);
+    return ((mantissa + 1) << shift) - 1;
+}
+
+void LatencyHistogram::raiseMax(uint64_t value) {
+    uint64_t seen = maxValue.load(std::memory_order_relaxed);
+    while (value > seen && !maxValue.compare_exchange_weak(seen, value, std::memory_order_relaxed)) {
+    }
+}
+
+void LatencyHistogram::record(uint64_t valueNs, uint64_t times) {
+    if (times == 0) return;
+    counts[bucketIndex(valueNs)].fetch_add(times, std::memory_order_relaxed);
+    totalCount.fetch_add(times, std::memory_order_relaxed);
+    raiseMax(valueNs > MAX_TRACKABLE ? MAX_TRACKABLE : valueNs);
+}
+
+void LatencyHistogram::merge(const LatencyHistogram& other) {
+    uint64_t added = 0;
+    for (int i = 0; i < BUCKET_COUNT; ++i) {
+        uint64_t count = other.counts[i].load(std::memory_order_relaxed);
+        if (count == 0) continue;
+        counts[i].fetch_add(count, std::memory_order_relaxed);
+        added += count;
+    }
+    // derived from the buckets actually copied so the total stays consistent
+    totalCount.fetch_add(added, std::memory_order_relaxed);
+    raiseMax(other.getMax());
+}
+
+void LatencyHistogram::reset() {
+    for (int i = 0; i < BUCKET_COUNT; ++i) counts[i].store(0, std::memory_order_relaxed);
+    totalCount.store(0, std::memory_order_relaxed);
+    maxValue.store(0, std::memory_order_relaxed);
+}
+
+int LatencyHistogram::exportBuckets(uint16_t* indices, uint32_t* bucketCounts, int maxBuckets) const {
+    int written = 0;
+    for (int i = 0; i < BUCKET_COUNT; ++i) {
+        uint64_t count = counts[i].load(std::memory_order_relaxed);
+        if (count == 0) continue;
+        if (written == maxBuckets || count > 0xFFFFFFFFULL) return -1;
+        indices[written] = (uint16_t)i;
+        bucketCounts[written] = (uint32_t)count;
+        ++written;
+    }
+    return written;
+}
+
+void LatencyHistogram::addToBucket(int index, uint64_t count) {
+    if (index < 0 || index >= BUCKET_COUNT || count == 0) return;
+    counts[index].fetch_add(count, std::memory_order_relaxed);
+    totalCount.fetch_add(count, std::memory_order_relaxed);
+}
+
+uint64_t LatencyHistogram::valueAtPerMillion(uint32_t perMillion) const {
+    uint64_t total = getTotalCount();
+    if (total == 0) return 0;
+    if (perMillion > 1000000) perMillion = 1000000;
+
+    // rank of the requested value, 1-based, rounded up
+    uint64_t rank = (total * perMillion + 999999) / 1000000;
+    if (rank == 0) rank = 1;
+
+    uint64_t seen = 0;
+    for (int i = 0; i < BUCKET_COUNT; ++i) {
+        seen += counts[i].load(std::memory_order_relaxed);
+        if (seen >= rank) {
+            uint64_t value = bucketHighestValue(i);
+            uint64_t max = getMax();
+            return value < max ? value : max;
+        }
+    }
+    return getMax();
+}
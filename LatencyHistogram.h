@@ -0,0 +1,58 @@
+// LatencyHistogram.h
+#ifndef LATENCY_HISTOGRAM_H
+#define LATENCY_HISTOGRAM_H
+
+#include <atomic>
+#include <cstddef>
+#include <cstdint>
+
+// ============================================================================
+// LATENCY HISTOGRAM
+// HDR-style log-linear histogram of nanosecond values: exact below 128, and
+// above that 64 linear sub-buckets per power of two (under 1.6% relative
+// error) up to 2^48 ns (~78 hours); larger values are clamped. Counters are
+// relaxed atomics, so any number of threads may record() into one histogram
+// without locks, and merge() is a single pass over the fixed bucket array.
+// ============================================================================
+class LatencyHistogram {
+public:
+    static const int SUB_BUCKET_BITS = 7;
+    static const uint64_t MAX_TRACKABLE = (1ULL << 48) - 1;
+    static const int BUCKET_COUNT = (48 - SUB_BUCKET_BITS + 2) << (SUB_BUCKET_BITS - 1);
+
+private:
+    std::atomic<uint64_t> counts[BUCKET_COUNT];
+    std::atomic<uint64_t> totalCount;
+    std::atomic<uint64_t> maxValue;
+
+    static int bucketIndex(uint64_t value);
+    static uint64_t bucketHighestValue(int index);
+
+public:
+    LatencyHistogram() { reset(); }
+
+    LatencyHistogram(const LatencyHistogram&) = delete;
+    LatencyHistogram& operator=(const LatencyHistogram&) = delete;
+
+    void record(uint64_t valueNs, uint64_t times = 1);
+    // adds other's counts into this histogram (other may still be recording)
+    void merge(const LatencyHistogram& other);
+    void reset();
+
+    // Sparse form for compact storage: the non-empty buckets in index order.
+    // exportBuckets returns how many it wrote, or -1 when more than maxBuckets
+    // are non-empty or a count does not fit in 32 bits.
+    int exportBuckets(uint16_t* indices, uint32_t* bucketCounts, int maxBuckets) const;
+    void addToBucket(int index, uint64_t count);
+    void raiseMax(uint64_t value);
+
+    uint64_t getTotalCount() const { return totalCount.load(std::memory_order_relaxed); }
+    uint64_t getMax() const { return maxValue.load(std::memory_order_relaxed); }
+
+    // Smallest recorded bucket value v such that at least perMillion / 10^6 of
+    // all values are <= v (reported as the bucket's highest equivalent value).
+    // 500000 => p50, 990000 => p99, 999000 => p99.9. 0 when empty.
+    uint64_t valueAtPerMillion(uint32_t perMillion) const;
+};
+
+#endif // LATENCY_HISTOGRAM_H
@@ -0,0 +1,314 @@
+// MultiRatSite.cpp
+#include "MultiRatSite.h"
+#include "OccupancyRecorder.h"
+#include "ResultWriter.h"
+#include "basicIO.h"
+
+extern basicIO io;
+
+// ============================================================================
+// MultiRatSite
+// ============================================================================
+
+MultiRatSite::MultiRatSite(const TowerConfig configs[LAYERS], SteeringPolicy steering)
+    : policy(steering), admitted(0), rejected(0), moved(0) {
+    for (int layer = 0; layer < LAYERS; ++layer) {
+        const GenerationType gen = static_cast<GenerationType>(layer);
+        layers[layer] = CellTower::create(gen, configs[layer]);
+        layers[layer]->setLazyPopulation(true);
+
+        LayerState& s = state[layer];
+        s.capacity = layers[layer]->getTotalCapacity();
+        s.users = 0;
+        for (int capability = 0; capability < LAYERS; ++capability) s.usersByCapability[capability] = 0;
+        s.pendingAdmissions = 0;
+        s.messagesPerUser = defaultMessagesPerUser(gen);
+        s.cores = 0;
+        s.messagesPerCore = CellTower::baseMessagesPerCore(gen);
+    }
+}
+
+// same result as the layer's calculateCoresNeeded(messagesPerUser, 0)
+void MultiRatSite::updateCores(int layer) {
+    LayerState& s = state[layer];
+    s.cores = s.users > 0
+        ? CellTower::coresForMessages(static_cast<GenerationType>(layer), s.users * s.messagesPerUser, 0)
+        : 0;
+}
+
+void MultiRatSite::changeUsers(int layer, int capability, long long delta) {
+    state[layer].users += delta;
+    state[layer].usersByCapability[capability] += delta;
+    updateCores(layer);
+}
+
+bool MultiRatSite::admit(int capability) {
+    int chosen = -1;
+    for (int layer = capability; layer >= 0; --layer) {
+        const LayerState& s = state[layer];
+        if (s.users >= s.capacity) continue;
+        if (chosen < 0) {
+            chosen = layer;
+            if (policy == STEER_BEST_GENERATION) break;
+            continue;
+        }
+        const LayerState& best = state[chosen];
+        if (policy == STEER_LEAST_UTILISED) {
+            // lower users / capacity wins; ties keep the newer generation
+            if (s.users * best.capacity < best.users * s.capacity) chosen = layer;
+        } else {
+            // best fit into cores already provisioned, else the cheapest layer per user
+            const long long spare = s.cores * s.messagesPerCore - s.users * s.messagesPerUser;
+            const long long bestSpare = best.cores * best.messagesPerCore - best.users * best.messagesPerUser;
+            const bool fits = spare >= s.messagesPerUser;
+            const bool bestFits = bestSpare >= best.messagesPerUser;
+            if (fits && (!bestFits || spare < bestSpare)) {
+                chosen = layer;
+            } else if (!fits && !bestFits &&
+                       (long long)s.messagesPerUser * best.messagesPerCore <
+                           (long long)best.messagesPerUser * s.messagesPerCore) {
+                chosen = layer;
+            }
+        }
+    }
+    if (chosen < 0) {
+        ++rejected;
+        return false;
+    }
+    changeUsers(chosen, capability, 1);
+    ++state[chosen].pendingAdmissions;
+    ++admitted;
+    return true;
+}
+
+void MultiRatSite::applyPendingAdmissions() {
+    for (int layer = 0; layer < LAYERS; ++layer) {
+        LayerState& s = state[layer];
+        if (s.pendingAdmissions == 0) continue;
+        layers[layer]->populate(layers[layer]->getNumUsers() + s.pendingAdmissions);
+        s.pendingAdmissions = 0;
+    }
+}
+
+void MultiRatSite::endTick() {
+    applyPendingAdmissions();
+}
+
+// Splits count users of layer over the capabilities of at least minCapability,
+// in proportion to how many of each the layer has; the rounding remainder
+// comes from the most capable devices.
+static void splitByCapability(const long long usersByCapability[MultiRatSite::LAYERS], int minCapability,
+                              long long count, long long taken[MultiRatSite::LAYERS]) {
+    long long eligible = 0;
+    for (int capability = 0; capability < MultiRatSite::LAYERS; ++capability) {
+        taken[capability] = 0;
+        if (capability >= minCapability) eligible += usersByCapability[capability];
+    }
+    if (eligible <= 0) return;
+    if (count > eligible) count = eligible;
+
+    long long assigned = 0;
+    for (int capability = minCapability; capability < MultiRatSite::LAYERS; ++capability) {
+        taken[capability] = usersByCapability[capability] * count / eligible;
+        assigned += taken[capability];
+    }
+    for (int capability = MultiRatSite::LAYERS - 1; capability >= minCapability && assigned < count; --capability) {
+        if (taken[capability] < usersByCapability[capability]) {
+            ++taken[capability];
+            ++assigned;
+        }
+    }
+}
+
+void MultiRatSite::removeUsers(int layer, long long count) {
+    long long taken[LAYERS];
+    splitByCapability(state[layer].usersByCapability, 0, count, taken);
+    for (int capability = 0; capability < LAYERS; ++capability) {
+        if (taken[capability] > 0) changeUsers(layer, capability, -taken[capability]);
+    }
+    layers[layer]->releaseUsers(count);
+}
+
+void MultiRatSite::depart(int departurePercent) {
+    applyPendingAdmissions();
+    for (int layer = 0; layer < LAYERS; ++layer) {
+        const long long leaving = state[layer].users * departurePercent / 100;
+        if (leaving > 0) removeUsers(layer, leaving);
+    }
+}
+
+void MultiRatSite::rebalance() {
+    applyPendingAdmissions();
+
+    // the pair of layers with the widest utilisation gap that has users able to move
+    int busiest = -1, idlest = -1;
+    long long widestGap = REBALANCE_GAP_PERCENT * 10;   // per mille
+    for (int from = 0; from < LAYERS; ++from) {
+        for (int to = 0; to < LAYERS; ++to) {
+            const LayerState& a = state[from];
+            const LayerState& b = state[to];
+            if (from == to || a.capacity <= 0 || b.capacity <= 0 || b.users >= b.capacity) continue;
+            const long long gap = a.users * 1000 / a.capacity - b.users * 1000 / b.capacity;
+            if (gap <= widestGap) continue;
+            long long movable = 0;
+            for (int capability = to; capability < LAYERS; ++capability) movable += a.usersByCapability[capability];
+            if (movable == 0) continue;
+            widestGap = gap;
+            busiest = from;
+            idlest = to;
+        }
+    }
+    if (busiest < 0) return;
+    const LayerState& from = state[busiest];
+    const LayerState& to = state[idlest];
+
+    // equalise utilisation, limited to users whose devices support the target
+    long long count = (from.users * to.capacity - to.users * from.capacity) / (from.capacity + to.capacity);
+    if (count > to.capacity - to.users) count = to.capacity - to.users;
+    long long taken[LAYERS];
+    splitByCapability(from.usersByCapability, idlest, count, taken);
+    count = 0;
+    for (int capability = 0; capability < LAYERS; ++capability) {
+        if (taken[capability] == 0) continue;
+        changeUsers(busiest, capability, -taken[capability]);
+        changeUsers(idlest, capability, taken[capability]);
+        count += taken[capability];
+    }
+    if (count == 0) return;
+    layers[busiest]->releaseUsers(count);
+    layers[idlest]->populate(layers[idlest]->getNumUsers() + count);
+    moved += count;
+}
+
+long long MultiRatSite::getTotalCores() const {
+    long long total = 0;
+    for (int layer = 0; layer < LAYERS; ++layer) total += state[layer].cores;
+    return total;
+}
+
+// ============================================================================
+// MultiRatStudy
+// ============================================================================
+
+MultiRatStudy::MultiRatStudy(const MultiRatOptions& opts, const CellularNetworkSimulator& simulator,
+                             ResultWriter* writer)
+    : options(opts), results(writer), recorder(nullptr) {
+    if (options.arrivalsPerTick < 1) throw InvalidConfigurationException("arrivals per tick must be positive");
+    if (options.ticks < 1) throw InvalidConfigurationException("tick count must be positive");
+    if (options.departurePercent < 0 || options.departurePercent > 100) {
+        throw InvalidConfigurationException("departure share must be 0-100");
+    }
+    for (int gen = GEN_2G; gen <= GEN_5G; ++gen) {
+        towerConfigs[gen] = simulator.getTowerConfig(static_cast<GenerationType>(gen));
+    }
+}
+
+// device mix: 5% 2G only, 10% up to 3G, 25% up to 4G, 60% 5G capable
+int MultiRatStudy::capabilityOf(long long index) {
+    const uint64_t share = (((uint64_t)index * 0x9E3779B97F4A7C15ULL) >> 32) % 100;
+    if (share < 5) return GEN_2G;
+    if (share < 15) return GEN_3G;
+    if (share < 40) return GEN_4G;
+    return GEN_5G;
+}
+
+void MultiRatStudy::run() {
+    io.outputstring("\n========== MULTI-RAT SITE ==========");
+    io.terminate();
+    {
+        MultiRatSite probe(towerConfigs, STEER_BEST_GENERATION);
+        io.outputstring("Layers:");
+        for (int layer = 0; layer < MultiRatSite::LAYERS; ++layer) {
+            io.outputstring(layer == 0 ? " " : ", ");
+            io.outputstring(generationName(static_cast<GenerationType>(layer)));
+            io.outputstring(" ");
+            io.outputlong(probe.getLayerCapacity(layer));
+        }
+        io.outputstring(" users");
+        io.terminate();
+    }
+    io.outputstring("Peak hour: ");
+    io.outputint(options.ticks);
+    io.outputstring(" ticks of ");
+    io.outputlong(options.arrivalsPerTick);
+    io.outputstring(" arrivals, ");
+    io.outputint(options.departurePercent);
+    io.outputstring("% of users leave per tick");
+    io.terminate();
+    io.outputstring("Devices: 5% 2G only, 10% up to 3G, 25% up to 4G, 60% 5G capable");
+    io.terminate();
+
+    for (int p = 0; p < STEERING_POLICY_COUNT; ++p) {
+        for (int withRebalancing = 0; withRebalancing <= 1; ++withRebalancing) {
+            const SteeringPolicy policy = static_cast<SteeringPolicy>(p);
+            MultiRatSite site(towerConfigs, policy);
+            int recorded[MultiRatSite::LAYERS];
+            if (recorder) {
+                const std::string run =
+                    std::string(steeringPolicyName(policy)) + (withRebalancing ? " + rebalancing " : " ");
+                for (int layer = 0; layer < MultiRatSite::LAYERS; ++layer) {
+                    const GenerationType gen = static_cast<GenerationType>(layer);
+                    recorded[layer] = recorder->addTower(site.getLayer(layer), run + generationName(gen));
+                }
+            }
+            long long peakCores = 0;
+            long long arrival = 0;
+            for (int tick = 0; tick < options.ticks; ++tick) {
+                for (long long i = 0; i < options.arrivalsPerTick; ++i) site.admit(capabilityOf(arrival++));
+                site.endTick();
+                if (site.getTotalCores() > peakCores) peakCores = site.getTotalCores();
+                if (recorder) {
+                    for (int layer = 0; layer < MultiRatSite::LAYERS; ++layer) {
+                        recorder->record(recorded[layer], tick, site.getLayer(layer));
+                    }
+                }
+                site.depart(options.departurePercent);
+                if (withRebalancing) site.rebalance();
+            }
+
+            if (recorder) {
+                for (int layer = 0; layer < MultiRatSite::LAYERS; ++layer) recorder->finishTower(recorded[layer]);
+            }
+
+            // the final figures come from the towers themselves
+            long long layerCores[MultiRatSite::LAYERS];
+            long long finalCores = 0;
+            for (int layer = 0; layer < MultiRatSite::LAYERS; ++layer) {
+                const CellTower& tower = site.getLayer(layer);
+                layerCores[layer] = tower.calculateCoresNeeded(defaultMessagesPerUser(tower.getGeneration()), 0);
+                finalCores += layerCores[layer];
+                if (tower.getNumUsers() != site.getLayerUsers(layer) || layerCores[layer] != site.getLayerCores(layer)) {
+                    throw NetworkException("multi-RAT layer cache out of step with its tower");
+                }
+            }
+
+            io.outputstring(steeringPolicyName(policy));
+            io.outputstring(withRebalancing ? " + rebalancing" : "");
+            io.outputstring(": admitted ");
+            io.outputlong(site.getAdmitted());
+            io.outputstring(", rejected ");
+            io.outputlong(site.getRejected());
+            io.outputstring(", moved ");
+            io.outputlong(site.getMoved());
+            io.outputstring(", peak cores ");
+            io.outputlong(peakCores);
+            io.outputstring(", final cores ");
+            io.outputlong(finalCores);
+            io.outputstring(" (");
+            for (int layer = 0; layer < MultiRatSite::LAYERS; ++layer) {
+                if (layer > 0) io.outputstring(", ");
+                io.outputstring(generationName(static_cast<GenerationType>(layer)));
+                io.outputstring(" ");
+                io.outputlong(layerCores[layer]);
+            }
+            io.outputstring(")");
+            io.terminate();
+
+            if (results) {
+                results->writeSteering(policy, withRebalancing != 0, site.getAdmitted(), site.getRejected(),
+                                       site.getMoved(), peakCores, finalCores);
+            }
+        }
+    }
+    if (results) results->flush();
+}
@@ -0,0 +1,110 @@
+// MultiRatSite.h
+#ifndef MULTI_RAT_SITE_H
+#define MULTI_RAT_SITE_H
+
+#include "CellularNetwork.h"
+#include <memory>
+
+class ResultWriter;
+class OccupancyRecorder;
+
+// ============================================================================
+// MULTI-RAT SITE
+// One Tower2G, Tower3G, Tower4G and Tower5G, co-located and live together
+// (lazily populated). Every arrival is steered to a layer its device
+// supports; rebalancing moves users off a layer far busier than another.
+// Decisions read a per-layer cache of users, headroom and provisioned cores
+// that each admission, departure and move updates in O(1), so the towers'
+// users are never rescanned.
+// ============================================================================
+class MultiRatSite {
+public:
+    static const int LAYERS = 4;   // indexed by GenerationType
+
+private:
+    struct LayerState {
+        long long capacity;
+        long long users;
+        long long usersByCapability[LAYERS];   // by the newest generation the device supports
+        long long pendingAdmissions;           // steered this tick, not yet on the tower
+        int messagesPerUser;
+        long long cores;                       // calculateCoresNeeded for users
+        long long messagesPerCore;
+    };
+
+    std::shared_ptr<CellTower> layers[LAYERS];
+    LayerState state[LAYERS];
+    SteeringPolicy policy;
+    long long admitted;
+    long long rejected;
+    long long moved;
+
+    void updateCores(int layer);
+    void changeUsers(int layer, int capability, long long delta);
+    void applyPendingAdmissions();
+    void removeUsers(int layer, long long count);
+
+public:
+    MultiRatSite(const TowerConfig configs[LAYERS], SteeringPolicy steering);
+
+    // steers one arrival whose device supports generations up to capability;
+    // false when every supported layer is full. Towers see the admissions at
+    // the next endTick().
+    bool admit(int capability);
+    // each layer loses departurePercent of its users (newest first)
+    void depart(int departurePercent);
+    // moves users between the two layers with the widest utilisation gap
+    // (over REBALANCE_GAP_PERCENT) that some of the busier layer's users'
+    // devices support, evening out their utilisation
+    void rebalance();
+    // pushes this tick's admissions onto the towers
+    void endTick();
+
+    static const int REBALANCE_GAP_PERCENT = 10;
+
+    long long getTotalCores() const;            // from the layer cache
+    long long getLayerCores(int layer) const { return state[layer].cores; }
+    long long getLayerUsers(int layer) const { return state[layer].users; }
+    long long getLayerCapacity(int layer) const { return state[layer].capacity; }
+    const CellTower& getLayer(int layer) const { return *layers[layer]; }
+    // for observers that keep state on the tower (the occupancy recorder's
+    // change tracking); users still come and go only through the site
+    CellTower& getLayer(int layer) { return *layers[layer]; }
+    long long getAdmitted() const { return admitted; }
+    long long getRejected() const { return rejected; }
+    long long getMoved() const { return moved; }
+};
+
+// ============================================================================
+// MULTI-RAT STUDY
+// Replays the same peak-hour arrival stream against a fresh site for every
+// steering policy, with and without rebalancing, and prints how the site's
+// total cores (the sum of each layer's calculateCoresNeeded) compare.
+// ============================================================================
+struct MultiRatOptions {
+    long long arrivalsPerTick = 2000;
+    int ticks = 60;                 // one per minute of the peak hour
+    int departurePercent = 2;       // of each layer's users, per tick
+};
+
+class MultiRatStudy {
+private:
+    MultiRatOptions options;
+    TowerConfig towerConfigs[MultiRatSite::LAYERS];
+    ResultWriter* results;
+    OccupancyRecorder* recorder;
+
+    // newest generation supported by the device of arrival number index
+    static int capabilityOf(long long index);
+
+public:
+    MultiRatStudy(const MultiRatOptions& opts, const CellularNetworkSimulator& simulator, ResultWriter* writer);
+
+    // records every layer's occupancy cube once per tick, one recorded
+    // tower per layer and run
+    void setRecorder(OccupancyRecorder* occupancyRecorder) { recorder = occupancyRecorder; }
+
+    void run();
+};
+
+#endif // MULTI_RAT_SITE_H
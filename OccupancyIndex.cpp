@@ -0,0 +1,90 @@
+// OccupancyIndex.cpp
+#include "OccupancyIndex.h"
+#include <algorithm>
+
+void OccupancyIndex::reset(int bands, int antennas, int channels, const std::vector<int>& perChannelLimit) {
+    numBands = bands > 0 ? bands : 0;
+    numAntennas = antennas > 0 ? antennas : 0;
+    numChannels = channels > 0 ? channels : 0;
+    usersPerChannel = perChannelLimit;
+    usersPerChannel.resize(numBands, 0);
+    counts.assign((size_t)numBands * numAntennas * numChannels, 0);
+    tree.assign((size_t)(numBands + 1) * (numAntennas + 1) * (numChannels + 1), 0);
+    totalUsers = 0;
+    changedCells.clear();
+    changeMarks.assign(trackingChanges ? counts.size() : 0, 0);
+}
+
+void OccupancyIndex::setChangeTracking(bool on) {
+    trackingChanges = on;
+    changedCells.clear();
+    changeMarks.assign(on ? counts.size() : 0, 0);
+}
+
+void OccupancyIndex::clearChanges() {
+    for (uint32_t cell : changedCells) changeMarks[cell] = 0;
+    changedCells.clear();
+}
+
+long long OccupancyIndex::prefixCount(int bands, int antennas, int channels) const {
+    long long sum = 0;
+    for (int b = bands; b > 0; b -= b & -b) {
+        for (int a = antennas; a > 0; a -= a & -a) {
+            for (int c = channels; c > 0; c -= c & -c) sum += tree[treeIndex(b, a, c)];
+        }
+    }
+    return sum;
+}
+
+long long OccupancyIndex::rangeCount(int bandLo, int bandHi, int antennaLo, int antennaHi,
+                                     int channelLo, int channelHi) const {
+    bandLo = std::max(bandLo, 0);
+    antennaLo = std::max(antennaLo, 0);
+    channelLo = std::max(channelLo, 0);
+    bandHi = std::min(bandHi, numBands - 1);
+    antennaHi = std::min(antennaHi, numAntennas - 1);
+    channelHi = std::min(channelHi, numChannels - 1);
+    if (bandLo > bandHi || antennaLo > antennaHi || channelLo > channelHi) return 0;
+
+    const int b0 = bandLo, b1 = bandHi + 1;
+    const int a0 = antennaLo, a1 = antennaHi + 1;
+    const int c0 = channelLo, c1 = channelHi + 1;
+    return prefixCount(b1, a1, c1)
+         - prefixCount(b0, a1, c1) - prefixCount(b1, a0, c1) - prefixCount(b1, a1, c0)
+         + prefixCount(b0, a0, c1) + prefixCount(b0, a1, c0) + prefixCount(b1, a0, c0)
+         - prefixCount(b0, a0, c0);
+}
+
+std::vector<ChannelLoad> OccupancyIndex::topSaturated(int k, int thresholdPercent) const {
+    std::vector<ChannelLoad> hits;
+    if (k <= 0) return hits;
+
+    for (int b = 0; b < numBands; ++b) {
+        const long long limit = usersPerChannel[b];
+        if (limit <= 0) continue;
+        // integer form of users * 100 / limit >= threshold
+        const long long minUsers = (limit * thresholdPercent + 99) / 100;
+        for (int a = 0; a < numAntennas; ++a) {
+            const int32_t* row = &counts[cellIndex(b, a, 0)];
+            for (int c = 0; c < numChannels; ++c) {
+                if (row[c] <= 0 || row[c] < minUsers) continue;
+                hits.push_back({b, a, c, row[c], (int)(row[c] * 100LL / limit)});
+            }
+        }
+    }
+
+    // cells were gathered in (band, antenna, channel) order, so a stable
+    // ordering on fullness keeps ties deterministic
+    auto fuller = [](const ChannelLoad& x, const ChannelLoad& y) {
+        if (x.percentFull != y.percentFull) return x.percentFull > y.percentFull;
+        if (x.band != y.band) return x.band < y.band;
+        if (x.antenna != y.antenna) return x.antenna < y.antenna;
+        return x.channel < y.channel;
+    };
+    if ((size_t)k < hits.size()) {
+        std::nth_element(hits.begin(), hits.begin() + k, hits.end(), fuller);
+        hits.resize(k);
+    }
+    std::sort(hits.begin(), hits.end(), fuller);
+    return hits;
+}
@@ -0,0 +1,106 @@
+// OccupancyIndex.h
+#ifndef OCCUPANCY_INDEX_H
+#define OCCUPANCY_INDEX_H
+
+#include <cstddef>
+#include <cstdint>
+#include <vector>
+
+// one (band, antenna, channel) cell of a tower and how full it is
+struct ChannelLoad {
+    int band;
+    int antenna;
+    int channel;
+    long long users;
+    int percentFull;   // users as a percentage of the cell's users-per-channel limit
+};
+
+// ============================================================================
+// OCCUPANCY INDEX
+// Dense per-tower count cube over band x antenna x channel, mirrored by a 3-D
+// Fenwick tree so add() and range counts both take O(log B * log A * log C).
+// Queries never modify the index, so any number of threads may read it while
+// no thread is adding; add() and reset() need the caller's exclusion.
+// With change tracking on, add() also lists each cell it touches once until
+// the consumer (the occupancy recorder) clears the list, so a per-tick
+// snapshot costs the cells that moved rather than the whole cube.
+// ============================================================================
+class OccupancyIndex {
+private:
+    int numBands;
+    int numAntennas;
+    int numChannels;                       // widest band; narrower bands leave trailing cells empty
+    std::vector<int> usersPerChannel;      // per band, for saturation queries
+    std::vector<int32_t> counts;           // [band][antenna][channel]
+    std::vector<int64_t> tree;             // Fenwick sums, 1-based, (B+1) x (A+1) x (C+1)
+    long long totalUsers;
+    bool trackingChanges;
+    std::vector<uint8_t> changeMarks;      // per cell: already in changedCells
+    std::vector<uint32_t> changedCells;
+
+    size_t cellIndex(int band, int antenna, int channel) const {
+        return ((size_t)band * numAntennas + antenna) * numChannels + channel;
+    }
+    size_t treeIndex(int band, int antenna, int channel) const {
+        return ((size_t)band * (numAntennas + 1) + antenna) * (numChannels + 1) + channel;
+    }
+    // users in cells [0, bands) x [0, antennas) x [0, channels)
+    long long prefixCount(int bands, int antennas, int channels) const;
+
+public:
+    OccupancyIndex() : numBands(0), numAntennas(0), numChannels(0), totalUsers(0), trackingChanges(false) {}
+
+    // clears all counts and resizes the cube (and any change list)
+    void reset(int bands, int antennas, int channels, const std::vector<int>& perChannelLimit);
+
+    bool contains(int band, int antenna, int channel) const {
+        return band >= 0 && band < numBands && antenna >= 0 && antenna < numAntennas &&
+               channel >= 0 && channel < numChannels;
+    }
+
+    void add(int band, int antenna, int channel, int delta = 1) {
+        const size_t cell = cellIndex(band, antenna, channel);
+        counts[cell] += delta;
+        if (trackingChanges && !changeMarks[cell]) {
+            changeMarks[cell] = 1;
+            changedCells.push_back((uint32_t)cell);
+        }
+        totalUsers += delta;
+        for (int b = band + 1; b <= numBands; b += b & -b) {
+            for (int a = antenna + 1; a <= numAntennas; a += a & -a) {
+                for (int c = channel + 1; c <= numChannels; c += c & -c) tree[treeIndex(b, a, c)] += delta;
+            }
+        }
+    }
+
+    long long count(int band, int antenna, int channel) const {
+        return contains(band, antenna, channel) ? counts[cellIndex(band, antenna, channel)] : 0;
+    }
+
+    // Active users over inclusive ranges; ranges are clamped to the cube.
+    long long rangeCount(int bandLo, int bandHi, int antennaLo, int antennaHi,
+                         int channelLo, int channelHi) const;
+    long long rangeCount(int antennaLo, int antennaHi, int channelLo, int channelHi) const {
+        return rangeCount(0, numBands - 1, antennaLo, antennaHi, channelLo, channelHi);
+    }
+    long long total() const { return totalUsers; }
+
+    // Up to k cells at or above thresholdPercent of their users-per-channel limit,
+    // fullest first (ties: band, antenna, channel order).
+    std::vector<ChannelLoad> topSaturated(int k, int thresholdPercent) const;
+
+    int getNumBands() const { return numBands; }
+    int getNumAntennas() const { return numAntennas; }
+    int getNumChannels() const { return numChannels; }
+    // the whole cube in [band][antenna][channel] order, for bulk copies
+    size_t getNumCells() const { return counts.size(); }
+    const int32_t* cellCounts() const { return counts.data(); }
+
+    // Cells whose count changed since the last clearChanges(), each once and
+    // in no particular order; empty unless tracking is on.
+    void setChangeTracking(bool on);
+    const std::vector<uint32_t>& getChangedCells() const { return changedCells; }
+    void clearChanges();
+};
+
+#endif // OCCUPANCY_INDEX_H
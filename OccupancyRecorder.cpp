@@ -0,0 +1,428 @@
+// OccupancyRecorder.cpp
+#include "OccupancyRecorder.h"
+#include <algorithm>
+#include <cerrno>
+#include <cstring>
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+static const char RECORD_MAGIC[8] = {'C', 'N', 'O', 'C', 'C', 'R', 'E', 'C'};
+static const size_t RECORD_HEADER_BYTES = 16;
+
+// ============================================================================
+// Varint helpers
+// ============================================================================
+
+static inline void putVarint(std::vector<uint8_t>& out, uint64_t value) {
+    while (value >= 0x80) {
+        out.push_back((uint8_t)(value | 0x80));
+        value >>= 7;
+    }
+    out.push_back((uint8_t)value);
+}
+
+static inline uint64_t zigzag(int64_t value) {
+    return ((uint64_t)value << 1) ^ (uint64_t)(value >> 63);
+}
+
+static inline int64_t unzigzag(uint64_t value) {
+    return (int64_t)(value >> 1) ^ -(int64_t)(value & 1);
+}
+
+// reads a varint at pos, which must stay below end; throws on truncation
+static uint64_t getVarint(const uint8_t* data, size_t& pos, size_t end) {
+    uint64_t value = 0;
+    for (int shift = 0; shift < 64; shift += 7) {
+        if (pos >= end) throw InvalidConfigurationException("truncated occupancy record");
+        const uint8_t byte = data[pos++];
+        value |= (uint64_t)(byte & 0x7F) << shift;
+        if (!(byte & 0x80)) return value;
+    }
+    throw InvalidConfigurationException("malformed varint in occupancy record");
+}
+
+// ============================================================================
+// OccupancyRecorder
+// ============================================================================
+
+OccupancyRecorder::OccupancyRecorder(const char* path)
+    : fd(-1), closing(false), failed(false), ticksRecorded(0), cellsRecorded(0), bytesWritten(0) {
+    fd = ::open(path, O_WRONLY | O_CREAT | O_TRUNC | O_CLOEXEC, 0644);
+    if (fd < 0) throw InvalidConfigurationException("cannot create occupancy record file");
+
+    uint8_t header[RECORD_HEADER_BYTES] = {0};
+    std::memcpy(header, RECORD_MAGIC, sizeof(RECORD_MAGIC));
+    std::memcpy(header + 8, &OCCUPANCY_RECORD_VERSION, sizeof(OCCUPANCY_RECORD_VERSION));
+    if (!writeAll(header, sizeof(header))) {
+        ::close(fd);
+        throw InvalidConfigurationException("cannot write occupancy record file");
+    }
+    writer = std::thread(&OccupancyRecorder::writeLoop, this);
+}
+
+OccupancyRecorder::~OccupancyRecorder() {
+    try {
+        close();
+    } catch (const NetworkException&) {
+        // already reported to whoever called close(); nothing to do in a destructor
+    }
+}
+
+bool OccupancyRecorder::writeAll(const uint8_t* data, size_t length) {
+    while (length > 0) {
+        ssize_t n = ::write(fd, data, length);
+        if (n < 0 && errno == EINTR) continue;
+        if (n <= 0) return false;
+        data += n;
+        length -= (size_t)n;
+        bytesWritten += n;
+    }
+    return true;
+}
+
+int OccupancyRecorder::addTower(CellTower& source, const std::string& label) {
+    const OccupancyIndex& occupancy = source.getOccupancy();
+    Job job;
+    job.type = 'T';
+    job.tower = (int)open.size();
+    job.info = {source.getGeneration(), occupancy.getNumBands(), occupancy.getNumAntennas(),
+                occupancy.getNumChannels(), label};
+
+    OpenChunk chunk;
+    chunk.cells = occupancy.getNumCells();
+    chunk.tickLimit = CHUNK_TICKS;
+    if (chunk.cells * CHUNK_TICKS > CHUNK_CELL_SAMPLES) {
+        chunk.tickLimit = chunk.cells < CHUNK_CELL_SAMPLES ? (int)(CHUNK_CELL_SAMPLES / chunk.cells) : 1;
+    }
+    chunk.firstTick = 0;
+    chunk.ticks = 0;
+    open.push_back(std::move(chunk));
+    source.setOccupancyTracking(true);
+    submit(std::move(job));
+    return (int)open.size() - 1;
+}
+
+void OccupancyRecorder::record(int tower, long long tick, CellTower& source) {
+    OpenChunk& chunk = open[(size_t)tower];
+    const OccupancyIndex& occupancy = source.getOccupancy();
+    if (occupancy.getNumCells() != chunk.cells) throw NetworkException("occupancy cube changed shape while recording");
+    if (chunk.ticks > 0 && tick != chunk.firstTick + chunk.ticks) flushChunk(tower);   // a gap starts a new chunk
+
+    // A chunk opens with a copy of the whole cube; after that a tick costs
+    // only the cells that moved, which for a busy tower is a small fraction.
+    const int32_t* counts = occupancy.cellCounts();
+    ChunkBuffers& data = chunk.data;
+    if (chunk.ticks == 0) {
+        chunk.firstTick = tick;
+        data = spareBuffers(chunk.cells);
+        std::copy_n(counts, chunk.cells, data.base.begin());
+    } else {
+        for (uint32_t cell : occupancy.getChangedCells()) data.updates.push_back({cell, counts[cell]});
+    }
+    data.tickEnds.push_back((uint32_t)data.updates.size());
+    source.clearOccupancyChanges();
+
+    ++chunk.ticks;
+    ++ticksRecorded;
+    cellsRecorded += (long long)chunk.cells;
+    if (chunk.ticks == chunk.tickLimit) flushChunk(tower);
+}
+
+void OccupancyRecorder::flushChunk(int tower) {
+    OpenChunk& chunk = open[(size_t)tower];
+    if (chunk.ticks == 0) return;
+    Job job;
+    job.type = 'C';
+    job.tower = tower;
+    job.chunk.cells = chunk.cells;
+    job.chunk.tickLimit = chunk.tickLimit;
+    job.chunk.firstTick = chunk.firstTick;
+    job.chunk.ticks = chunk.ticks;
+    job.chunk.data = std::move(chunk.data);   // the next tick takes spare buffers
+    chunk.data = ChunkBuffers();
+    chunk.ticks = 0;
+    submit(std::move(job));
+}
+
+// Encoded chunks hand their buffers back here, so a busy tower reuses them
+// instead of faulting in a fresh cube's worth of pages every CHUNK_TICKS.
+OccupancyRecorder::ChunkBuffers OccupancyRecorder::spareBuffers(size_t cells) {
+    ChunkBuffers buffers;
+    {
+        std::lock_guard<std::mutex> guard(lock);
+        for (size_t i = 0; i < spare.size(); ++i) {
+            if (spare[i].base.capacity() < cells || spare[i].base.capacity() / 2 > cells) continue;
+            buffers = std::move(spare[i]);
+            spare.erase(spare.begin() + (long)i);
+            break;
+        }
+    }
+    buffers.base.resize(cells);
+    buffers.updates.clear();
+    buffers.tickEnds.clear();
+    return buffers;
+}
+
+void OccupancyRecorder::recycle(ChunkBuffers&& buffers) {
+    std::lock_guard<std::mutex> guard(lock);
+    if (spare.size() < MAX_SPARE_BUFFERS) spare.push_back(std::move(buffers));
+}
+
+void OccupancyRecorder::submit(Job&& job) {
+    std::unique_lock<std::mutex> guard(lock);
+    drained.wait(guard, [this]() { return queue.size() < MAX_QUEUED_CHUNKS; });
+    queue.push_back(std::move(job));
+    queued.notify_one();
+}
+
+void OccupancyRecorder::close() {
+    if (fd < 0) return;
+    for (size_t tower = 0; tower < open.size(); ++tower) flushChunk((int)tower);
+    {
+        std::lock_guard<std::mutex> guard(lock);
+        closing = true;
+    }
+    queued.notify_one();
+    writer.join();
+    ::close(fd);
+    fd = -1;
+    if (failed) throw NetworkException("occupancy record could not be written");
+}
+
+void OccupancyRecorder::writeLoop() {
+    std::vector<uint8_t> block;
+    for (;;) {
+        Job job;
+        {
+            std::unique_lock<std::mutex> guard(lock);
+            queued.wait(guard, [this]() { return closing || !queue.empty(); });
+            if (queue.empty()) return;
+            job = std::move(queue.front());
+            queue.pop_front();
+        }
+        drained.notify_one();
+
+        const size_t start = encode(job, block);
+        if (!failed && !writeAll(block.data() + start, block.size() - start)) failed = true;
+        if (job.type == 'C') recycle(std::move(job.chunk.data));
+    }
+}
+
+// writes value as a varint at out, returning the end; up to 10 bytes
+static inline uint8_t* putVarint(uint8_t* out, uint64_t value) {
+    while (value >= 0x80) {
+        *out++ = (uint8_t)(value | 0x80);
+        value >>= 7;
+    }
+    *out++ = (uint8_t)value;
+    return out;
+}
+
+// Encodes one block into out: type byte, varint payload length, payload.
+// The payload is built after BLOCK_HEADER_MAX spare bytes and the header is
+// written just in front of it; returns the offset where the block starts.
+static const size_t BLOCK_HEADER_MAX = 11;
+
+size_t OccupancyRecorder::encode(const Job& job, std::vector<uint8_t>& out) {
+    out.clear();
+    out.resize(BLOCK_HEADER_MAX);
+    putVarint(out, (uint64_t)job.tower);
+    if (job.type == 'T') {
+        putVarint(out, (uint64_t)job.info.generation);
+        putVarint(out, (uint64_t)job.info.bands);
+        putVarint(out, (uint64_t)job.info.antennas);
+        putVarint(out, (uint64_t)job.info.channels);
+        putVarint(out, job.info.label.size());
+        out.insert(out.end(), job.info.label.begin(), job.info.label.end());
+    } else {
+        const OpenChunk& chunk = job.chunk;
+        putVarint(out, (uint64_t)chunk.firstTick);
+        putVarint(out, (uint64_t)chunk.ticks);
+
+        // Group the chunk's updates by cell (a counting sort, so each cell's
+        // stay in tick order), packed as tick << 32 | count.
+        const ChunkBuffers& data = chunk.data;
+        cellEnds.assign(chunk.cells + 1, 0);
+        for (const CellUpdate& update : data.updates) ++cellEnds[update.cell + 1];
+        for (size_t cell = 1; cell <= chunk.cells; ++cell) cellEnds[cell] += cellEnds[cell - 1];
+        byCell.resize(data.updates.size());
+        size_t u = 0;
+        for (int t = 1; t < chunk.ticks; ++t) {
+            for (; u < data.tickEnds[(size_t)t]; ++u) {
+                const CellUpdate& update = data.updates[u];
+                byCell[cellEnds[update.cell]++] = (uint64_t)t << 32 | (uint32_t)update.count;
+            }
+        }
+        // cellEnds[cell] now ends the cell's updates (and starts the next's)
+
+        // A column is a delta per change plus, before it, a zero delta and a
+        // count for the unchanged ticks since the last one: at most 7 bytes a
+        // tick and 2 for the tail, after its skip count and length prefix.
+        const size_t columnMax = 14 + (size_t)chunk.ticks * 7;
+        size_t used = out.size();
+
+        // Cells that stay at zero for the whole chunk (most of them) only add
+        // to the next column's skip count.
+        uint64_t skipped = 0;
+        size_t first = 0;
+        for (size_t cell = 0; cell < chunk.cells; ++cell) {
+            const size_t last = cellEnds[cell];
+            if (data.base[cell] == 0 && first == last) {
+                ++skipped;
+                continue;
+            }
+            uint8_t column[CHUNK_TICKS * 7 + 2];
+            uint8_t* end = column;
+            int64_t previous = 0;
+            int next = 0;                // first tick not yet covered by the column
+            auto change = [&](int t, int32_t value) {
+                if (value == previous) return;
+                if (t > next) {
+                    end = putVarint(end, 0);
+                    end = putVarint(end, (uint64_t)(t - next - 1));
+                }
+                end = putVarint(end, zigzag(value - previous));
+                previous = value;
+                next = t + 1;
+            };
+            change(0, data.base[cell]);
+            for (size_t i = first; i < last; ++i) change((int)(byCell[i] >> 32), (int32_t)(uint32_t)byCell[i]);
+            first = last;
+            if (end == column) {         // changed, but only ever back to zero
+                ++skipped;
+                continue;
+            }
+            if (next < chunk.ticks) {
+                end = putVarint(end, 0);
+                end = putVarint(end, (uint64_t)(chunk.ticks - next - 1));
+            }
+            if (out.size() - used < columnMax) out.resize(out.size() * 2 + columnMax);
+            uint8_t* write = putVarint(out.data() + used, skipped);
+            write = putVarint(write, (uint64_t)(end - column));
+            std::memcpy(write, column, (size_t)(end - column));
+            used = (size_t)(write + (end - column) - out.data());
+            skipped = 0;
+        }
+        out.resize(used);
+    }
+
+    uint8_t header[BLOCK_HEADER_MAX];
+    header[0] = (uint8_t)job.type;
+    const size_t headerBytes = (size_t)(putVarint(header + 1, out.size() - BLOCK_HEADER_MAX) - header);
+    const size_t start = BLOCK_HEADER_MAX - headerBytes;
+    std::memcpy(out.data() + start, header, headerBytes);
+    return start;
+}
+
+// ============================================================================
+// OccupancyRecordReader
+// ============================================================================
+
+OccupancyRecordReader::OccupancyRecordReader(const char* path) : map(nullptr), mapBytes(0) {
+    int fd = ::open(path, O_RDONLY | O_CLOEXEC);
+    if (fd < 0) throw InvalidConfigurationException("cannot open occupancy record file");
+    struct stat info;
+    if (fstat(fd, &info) != 0 || (size_t)info.st_size < RECORD_HEADER_BYTES) {
+        ::close(fd);
+        throw InvalidConfigurationException("not an occupancy record file");
+    }
+    mapBytes = (size_t)info.st_size;
+    map = mmap(nullptr, mapBytes, PROT_READ, MAP_PRIVATE, fd, 0);
+    ::close(fd);
+    if (map == MAP_FAILED) {
+        map = nullptr;
+        throw InvalidConfigurationException("cannot map occupancy record file");
+    }
+
+    const uint8_t* data = static_cast<const uint8_t*>(map);
+    uint32_t version;
+    std::memcpy(&version, data + 8, sizeof(version));
+    if (std::memcmp(data, RECORD_MAGIC, sizeof(RECORD_MAGIC)) != 0 || version != OCCUPANCY_RECORD_VERSION) {
+        munmap(map, mapBytes);
+        map = nullptr;
+        throw InvalidConfigurationException("not an occupancy record file of this version");
+    }
+
+    // index the blocks; chunk payloads stay unread until a query needs them
+    try {
+        size_t pos = RECORD_HEADER_BYTES;
+        while (pos < mapBytes) {
+            const uint8_t type = data[pos++];
+            const uint64_t length = getVarint(data, pos, mapBytes);
+            if (length > mapBytes - pos) throw InvalidConfigurationException("truncated occupancy record");
+            const size_t end = pos + (size_t)length;
+            const int tower = (int)getVarint(data, pos, end);
+
+            if (type == 'T') {
+                if (tower != (int)towers.size()) {
+                    throw InvalidConfigurationException("occupancy record towers out of order");
+                }
+                RecordedTower info;
+                info.generation = static_cast<GenerationType>(getVarint(data, pos, end));
+                info.bands = (int)getVarint(data, pos, end);
+                info.antennas = (int)getVarint(data, pos, end);
+                info.channels = (int)getVarint(data, pos, end);
+                const uint64_t labelLength = getVarint(data, pos, end);
+                if (labelLength > end - pos) throw InvalidConfigurationException("truncated occupancy record");
+                info.label.assign(reinterpret_cast<const char*>(data + pos), (size_t)labelLength);
+                towers.push_back(info);
+            } else if (type == 'C') {
+                if (tower < 0 || tower >= (int)towers.size()) {
+                    throw InvalidConfigurationException("chunk of an unknown tower");
+                }
+                ChunkRef chunk;
+                chunk.tower = tower;
+                chunk.firstTick = (long long)getVarint(data, pos, end);
+                chunk.ticks = (int)getVarint(data, pos, end);
+                chunk.offset = pos;
+                chunk.length = end - pos;
+                chunks.push_back(chunk);
+            } else {
+                throw InvalidConfigurationException("unknown block in occupancy record");
+            }
+            pos = end;
+        }
+    } catch (...) {
+        munmap(map, mapBytes);
+        map = nullptr;
+        throw;
+    }
+}
+
+OccupancyRecordReader::~OccupancyRecordReader() {
+    if (map) munmap(map, mapBytes);
+}
+
+void OccupancyRecordReader::decodeChunk(const ChunkRef& chunk, std::vector<int32_t>& rows) const {
+    const uint8_t* data = static_cast<const uint8_t*>(map);
+    const size_t cells = towers[chunk.tower].cells();
+    rows.assign(cells * (size_t)chunk.ticks, 0);
+
+    size_t pos = chunk.offset;
+    const size_t end = chunk.offset + chunk.length;
+    size_t cell = 0;
+    while (pos < end) {
+        const uint64_t skipped = getVarint(data, pos, end);
+        if (skipped >= cells - cell) throw InvalidConfigurationException("malformed occupancy record");
+        cell += (size_t)skipped;
+        const uint64_t columnBytes = getVarint(data, pos, end);
+        if (columnBytes > end - pos) throw InvalidConfigurationException("truncated occupancy record");
+        const size_t columnEnd = pos + (size_t)columnBytes;
+        int64_t value = 0;
+        for (int t = 0; t < chunk.ticks; ++t) {
+            const uint64_t delta = getVarint(data, pos, columnEnd);
+            value += unzigzag(delta);
+            rows[(size_t)t * cells + cell] = (int32_t)value;
+            if (delta != 0) continue;
+            const uint64_t run = getVarint(data, pos, columnEnd);
+            if (run > (uint64_t)(chunk.ticks - 1 - t)) {
+                throw InvalidConfigurationException("malformed occupancy record");
+            }
+            for (uint64_t r = 0; r < run; ++r) rows[(size_t)(++t) * cells + cell] = (int32_t)value;
+        }
+        if (pos != columnEnd) throw InvalidConfigurationException("malformed occupancy record");
+        ++cell;
+    }
+}
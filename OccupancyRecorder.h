@@ -0,0 +1,186 @@
+// OccupancyRecorder.h
+#ifndef OCCUPANCY_RECORDER_H
+#define OCCUPANCY_RECORDER_H
+
+#include "CellularNetwork.h"
+#include <condition_variable>
+#include <cstddef>
+#include <cstdint>
+#include <deque>
+#include <mutex>
+#include <string>
+#include <thread>
+#include <vector>
+
+// ============================================================================
+// OCCUPANCY TIME SERIES FILE
+// Append-only stream of blocks after an 16-byte header ("CNOCCREC", format
+// version, reserved). Every block is a type byte, a varint payload length
+// and the payload:
+//   'T' tower:  id, generation, bands, antennas, channels, label
+//   'C' chunk:  tower id, first tick, tick count, then a column for each
+//               cell of the tower's occupancy cube (band, antenna, channel
+//               order) that is not zero throughout the chunk: a varint count
+//               of such all-zero cells skipped since the previous column, the
+//               column's varint byte length, and the cell's values as zigzag
+//               varint deltas (the first from 0), where a zero delta is
+//               followed by a varint count of further zero deltas
+// A chunk holds up to CHUNK_TICKS consecutive ticks of one tower (fewer for
+// cubes past CHUNK_CELL_SAMPLES / CHUNK_TICKS cells) and decodes on its own,
+// so a time-range read skips every other chunk unopened.
+// ============================================================================
+static const uint32_t OCCUPANCY_RECORD_VERSION = 1;
+
+struct RecordedTower {
+    GenerationType generation;
+    int bands;
+    int antennas;
+    int channels;
+    std::string label;
+
+    size_t cells() const { return (size_t)bands * antennas * channels; }
+};
+
+// ============================================================================
+// OCCUPANCY RECORDER
+// The simulation thread hands each tower's occupancy over once per tick: the
+// whole cube at the first tick of a chunk, then only the cells the tower's
+// index reports changed since the previous tick. A background thread
+// delta-encodes full chunks, appends them to the file and hands their
+// buffers back for reuse. Chunks queue up to MAX_QUEUED_CHUNKS deep, after
+// which record() waits for the writer. One producer thread.
+// ============================================================================
+class OccupancyRecorder {
+public:
+    static const int CHUNK_TICKS = 64;
+    static const size_t CHUNK_CELL_SAMPLES = 1 << 22;   // bounds a chunk's updates to 32 MB
+    static const size_t MAX_QUEUED_CHUNKS = 8;
+    static const size_t MAX_SPARE_BUFFERS = 8;
+
+private:
+    struct CellUpdate {
+        uint32_t cell;
+        int32_t count;
+    };
+    struct ChunkBuffers {
+        std::vector<int32_t> base;           // every cell at the chunk's first tick
+        std::vector<CellUpdate> updates;     // cells changed at later ticks, tick by tick
+        std::vector<uint32_t> tickEnds;      // per tick, the end of its updates
+    };
+    struct OpenChunk {
+        size_t cells;
+        int tickLimit;               // ticks per chunk for this cube
+        long long firstTick;
+        int ticks;
+        ChunkBuffers data;
+    };
+    struct Job {
+        char type;                   // 'T' or 'C'
+        int tower;
+        RecordedTower info;          // 'T'
+        OpenChunk chunk;             // 'C'
+    };
+
+    int fd;
+    std::vector<OpenChunk> open;     // per tower (producer side only)
+    std::deque<Job> queue;
+    std::vector<ChunkBuffers> spare; // encoded chunks' buffers
+    std::mutex lock;
+    std::condition_variable queued;
+    std::condition_variable drained;
+    bool closing;
+    bool failed;                     // a write failed; reported by close()
+    std::thread writer;
+
+    long long ticksRecorded;         // producer side
+    long long cellsRecorded;
+    long long bytesWritten;          // writer side, read after join
+    std::vector<uint32_t> cellEnds;  // writer side: a chunk's updates grouped by cell
+    std::vector<uint64_t> byCell;
+
+    ChunkBuffers spareBuffers(size_t cells);
+    void recycle(ChunkBuffers&& buffers);
+    void submit(Job&& job);
+    void flushChunk(int tower);
+    void writeLoop();
+    size_t encode(const Job& job, std::vector<uint8_t>& out);
+    bool writeAll(const uint8_t* data, size_t length);
+
+public:
+    // Creates (truncates) path. Throws InvalidConfigurationException on failure.
+    explicit OccupancyRecorder(const char* path);
+    ~OccupancyRecorder();
+
+    OccupancyRecorder(const OccupancyRecorder&) = delete;
+    OccupancyRecorder& operator=(const OccupancyRecorder&) = delete;
+
+    // registers a tower with the shape of its occupancy cube and turns on its
+    // occupancy change tracking; returns its id
+    int addTower(CellTower& source, const std::string& label);
+    // the tower's occupancy at tick, which clears its changed cells; ticks of
+    // a tower must increase
+    void record(int tower, long long tick, CellTower& source);
+    // writes out the tower's open chunk early, once it will record no more
+    void finishTower(int tower) { flushChunk(tower); }
+    // writes out the open chunks and waits for the writer; throws
+    // NetworkException if anything could not be written
+    void close();
+
+    long long getTicksRecorded() const { return ticksRecorded; }
+    long long getCellsRecorded() const { return cellsRecorded; }   // cell samples
+    long long getBytesWritten() const { return bytesWritten; }     // valid after close()
+};
+
+// ============================================================================
+// OCCUPANCY RECORD READER
+// Maps a recorded file and indexes its blocks; read() decodes only the
+// chunks that overlap the requested tick range.
+// ============================================================================
+class OccupancyRecordReader {
+private:
+    struct ChunkRef {
+        int tower;
+        long long firstTick;
+        int ticks;
+        size_t offset;     // of the first column in the mapping
+        size_t length;
+    };
+
+    void* map;
+    size_t mapBytes;
+    std::vector<RecordedTower> towers;
+    std::vector<ChunkRef> chunks;
+
+    // rows receives [tick][cell] of the whole chunk
+    void decodeChunk(const ChunkRef& chunk, std::vector<int32_t>& rows) const;
+
+public:
+    // Throws InvalidConfigurationException when path is not a valid record.
+    explicit OccupancyRecordReader(const char* path);
+    ~OccupancyRecordReader();
+
+    OccupancyRecordReader(const OccupancyRecordReader&) = delete;
+    OccupancyRecordReader& operator=(const OccupancyRecordReader&) = delete;
+
+    const std::vector<RecordedTower>& getTowers() const { return towers; }
+
+    // Calls visit(tower, tick, cells) with the occupancy cube of every
+    // recorded tick in [fromTick, toTick], chunk by chunk in file order (each
+    // tower's ticks ascending).
+    template <typename TickVisitor>
+    void read(long long fromTick, long long toTick, TickVisitor visit) const {
+        std::vector<int32_t> rows;
+        for (const ChunkRef& chunk : chunks) {
+            if (chunk.firstTick > toTick || chunk.firstTick + chunk.ticks - 1 < fromTick) continue;
+            decodeChunk(chunk, rows);
+            const size_t cells = towers[chunk.tower].cells();
+            for (int t = 0; t < chunk.ticks; ++t) {
+                const long long tick = chunk.firstTick + t;
+                if (tick < fromTick || tick > toTick) continue;
+                visit(chunk.tower, tick, rows.data() + (size_t)t * cells);
+            }
+        }
+    }
+};
+
+#endif // OCCUPANCY_RECORDER_H
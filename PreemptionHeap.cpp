@@ -0,0 +1,62 @@
+// PreemptionHeap.cpp
+#include "PreemptionHeap.h"
+
+void PreemptionHeap::siftUp(size_t index) {
+    Entry moving = heap[index];
+    while (index > 0) {
+        size_t parent = (index - 1) / 2;
+        if (heap[parent].key >= moving.key) break;
+        place(index, heap[parent]);
+        index = parent;
+    }
+    place(index, moving);
+}
+
+void PreemptionHeap::siftDown(size_t index) {
+    Entry moving = heap[index];
+    const size_t count = heap.size();
+    while (true) {
+        size_t child = 2 * index + 1;
+        if (child >= count) break;
+        if (child + 1 < count && heap[child + 1].key > heap[child].key) ++child;
+        if (moving.key >= heap[child].key) break;
+        place(index, heap[child]);
+        index = child;
+    }
+    place(index, moving);
+}
+
+void PreemptionHeap::build(const std::vector<long long>& slots, const std::vector<uint64_t>& keys) {
+    clear();
+    heap.resize(slots.size());
+    for (size_t i = 0; i < slots.size(); ++i) {
+        if ((size_t)slots[i] >= position.size()) position.resize((size_t)slots[i] + 1, -1);
+        place(i, {keys[i], slots[i]});
+    }
+    for (size_t i = heap.size() / 2; i-- > 0;) siftDown(i);
+}
+
+void PreemptionHeap::clear() {
+    heap.clear();
+    position.clear();
+}
+
+void PreemptionHeap::push(long long slot, uint64_t key) {
+    if ((size_t)slot >= position.size()) position.resize((size_t)slot + 1, -1);
+    heap.push_back({key, slot});
+    siftUp(heap.size() - 1);
+}
+
+void PreemptionHeap::remove(long long slot) {
+    if (!contains(slot)) return;
+    size_t index = (size_t)position[(size_t)slot];
+    position[(size_t)slot] = -1;
+    Entry last = heap.back();
+    heap.pop_back();
+    if (index == heap.size()) return;
+
+    // the former last entry fills the hole and moves whichever way it must
+    place(index, last);
+    if (index > 0 && heap[(index - 1) / 2].key < last.key) siftUp(index);
+    else siftDown(index);
+}
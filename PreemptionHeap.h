@@ -0,0 +1,50 @@
+// PreemptionHeap.h
+#ifndef PREEMPTION_HEAP_H
+#define PREEMPTION_HEAP_H
+
+#include <cstddef>
+#include <cstdint>
+#include <vector>
+
+// ============================================================================
+// PREEMPTION HEAP
+// Indexed binary max-heap of user-store slots keyed by how pre-emptable the
+// slot's user is (see CellTower::preemptionKey). A per-slot position index
+// lets any slot be removed in O(log n) when its user detaches; push, pop and
+// remove are all O(log n), top() is O(1).
+// ============================================================================
+class PreemptionHeap {
+private:
+    struct Entry {
+        uint64_t key;
+        long long slot;
+    };
+    std::vector<Entry> heap;
+    std::vector<long long> position;   // per slot: index in heap, -1 when absent
+
+    void place(size_t index, const Entry& entry) {
+        heap[index] = entry;
+        position[(size_t)entry.slot] = (long long)index;
+    }
+    void siftUp(size_t index);
+    void siftDown(size_t index);
+
+public:
+    // replaces the contents with the given (slot, key) pairs in O(n)
+    void build(const std::vector<long long>& slots, const std::vector<uint64_t>& keys);
+    void clear();
+
+    void push(long long slot, uint64_t key);
+    // no-op when slot is not in the heap
+    void remove(long long slot);
+
+    bool empty() const { return heap.empty(); }
+    size_t size() const { return heap.size(); }
+    long long topSlot() const { return heap.front().slot; }
+    uint64_t topKey() const { return heap.front().key; }
+    bool contains(long long slot) const {
+        return slot >= 0 && (size_t)slot < position.size() && position[(size_t)slot] >= 0;
+    }
+};
+
+#endif // PREEMPTION_HEAP_H
@@ -0,0 +1,373 @@
+// ResultWriter.cpp
+#include "ResultWriter.h"
+#include <algorithm>
+#include <cstring>
+#include <fcntl.h>
+#include <unistd.h>
+
+#define SYS_WRITE 1
+
+extern "C" long syscall3(long number, long arg1, long arg2, long arg3);
+
+// two-digit lookup table: formats a pair of decimal digits per step
+static const char DIGIT_PAIRS[] =
+    "00010203040506070809101112131415161718192021222324252627282930313233343536373839"
+    "40414243444546474849505152535455565758596061626364656667686970717273747576777879"
+    "8081828384858687888990919293949596979899";
+
+static const char* const RECORD_NAMES[ResultWriter::RECORD_TYPE_COUNT] = {
+    "tower_capacity",
+    "channel_occupancy",
+    "core_count",
+    "scenario",
+    "user",
+    "latency",
+    "core_packing",
+    "admission",
+    "steering",
+    "saturated_cell"
+};
+
+// CSV header rows (column names after the leading "record" column)
+static const char* const RECORD_HEADERS[ResultWriter::RECORD_TYPE_COUNT] = {
+    "record,generation,total_capacity,channels,users_per_channel,antennas",
+    "record,generation,band,antenna,channel,users",
+    "record,generation,messages_per_user,overhead_per_100,cores",
+    "record,generation,antennas,overhead_per_100,messages_per_user,users,total_capacity,cores",
+    "record,generation,device_id,channel,antenna,band,active,messages",
+    "record,generation,scope,messages,p50_ns,p99_ns,p999_ns,max_ns",
+    "record,generation,granularity,items,cores,lower_bound,efficiency_permille,split_groups,oversized_items,solve_us",
+    "record,generation,qos_class,admitted,preempted,rejected",
+    "record,policy,rebalancing,admitted,rejected,moved,peak_cores,final_cores",
+    "record,generation,rank,band,antenna,channel,users,percent_full,antenna_users"
+};
+
+ResultWriter::ResultWriter(ResultFormat fmt, int outputFd, size_t bufferBytes)
+    : format(fmt), fd(outputFd), ownsFd(outputFd > 2), used(0) {
+    if (bufferBytes < MAX_RECORD_BYTES * 4) bufferBytes = MAX_RECORD_BYTES * 4;
+    if (format != RESULT_NONE) buffer.resize(bufferBytes);
+    for (int i = 0; i < RECORD_TYPE_COUNT; ++i) {
+        headerWritten[i] = false;
+        firstRecordOffset[i] = 0;
+    }
+}
+
+ResultWriter::~ResultWriter() {
+    try {
+        flush();
+    } catch (const NetworkException&) {
+        // nothing sensible left to do with a write failure during teardown
+    }
+    if (ownsFd) close(fd);
+}
+
+int ResultWriter::openOutputFile(const char* path) {
+    int outFd = open(path, O_WRONLY | O_CREAT | O_TRUNC, 0644);
+    if (outFd < 0) throw InvalidConfigurationException("cannot open results file");
+    return outFd;
+}
+
+void ResultWriter::flush() {
+    if (fd == IN_MEMORY) return;
+    size_t offset = 0;
+    while (offset < used) {
+        long written = syscall3(SYS_WRITE, fd, (long)(buffer.data() + offset), (long)(used - offset));
+        if (written <= 0) {
+            used = 0;
+            throw NetworkException("results write failed");
+        }
+        offset += (size_t)written;
+    }
+    used = 0;
+}
+
+void ResultWriter::putString(const char* text) {
+    while (*text) buffer[used++] = *text++;
+}
+
+void ResultWriter::putInt(long long value) {
+    unsigned long long magnitude;
+    if (value < 0) {
+        putChar('-');
+        magnitude = 0ULL - (unsigned long long)value;
+    } else {
+        magnitude = (unsigned long long)value;
+    }
+
+    char digits[24];
+    int pos = 24;
+    while (magnitude >= 100) {
+        unsigned idx = (unsigned)(magnitude % 100) * 2;
+        magnitude /= 100;
+        digits[--pos] = DIGIT_PAIRS[idx + 1];
+        digits[--pos] = DIGIT_PAIRS[idx];
+    }
+    if (magnitude >= 10) {
+        unsigned idx = (unsigned)magnitude * 2;
+        digits[--pos] = DIGIT_PAIRS[idx + 1];
+        digits[--pos] = DIGIT_PAIRS[idx];
+    } else {
+        digits[--pos] = (char)('0' + magnitude);
+    }
+    while (pos < 24) buffer[used++] = digits[pos++];
+}
+
+void ResultWriter::writeHeader(RecordType type) {
+    headerWritten[type] = true;
+    if (format != RESULT_CSV) return;
+    putString(RECORD_HEADERS[type]);
+    putChar('\n');
+}
+
+void ResultWriter::beginRecord(RecordType type) {
+    ensureRoom(MAX_RECORD_BYTES);
+    if (!headerWritten[type]) {
+        if (fd == IN_MEMORY) {
+            headerWritten[type] = true;
+            firstRecordOffset[type] = used;
+        } else {
+            writeHeader(type);
+        }
+    }
+    if (format == RESULT_JSON) {
+        putString("{\"record\":\"");
+        putString(RECORD_NAMES[type]);
+        putChar('"');
+    } else {
+        putString(RECORD_NAMES[type]);
+    }
+}
+
+void ResultWriter::field(const char* name, long long value) {
+    if (format == RESULT_JSON) {
+        putString(",\"");
+        putString(name);
+        putString("\":");
+    } else {
+        putChar(',');
+    }
+    putInt(value);
+}
+
+// string values are internal identifiers only, so no escaping is required
+void ResultWriter::field(const char* name, const char* value) {
+    if (format == RESULT_JSON) {
+        putString(",\"");
+        putString(name);
+        putString("\":\"");
+        putString(value);
+        putChar('"');
+    } else {
+        putChar(',');
+        putString(value);
+    }
+}
+
+void ResultWriter::endRecord() {
+    if (format == RESULT_JSON) putChar('}');
+    putChar('\n');
+}
+
+// ============================================================================
+// Record writers
+// ============================================================================
+
+void ResultWriter::writeTowerCapacity(GenerationType gen, long long totalCapacity, int numChannels,
+                                      int usersPerChannel, int numAntennas) {
+    if (!isEnabled()) return;
+    beginRecord(RECORD_TOWER_CAPACITY);
+    field("generation", generationName(gen));
+    field("total_capacity", totalCapacity);
+    field("channels", numChannels);
+    field("users_per_channel", usersPerChannel);
+    field("antennas", numAntennas);
+    endRecord();
+}
+
+void ResultWriter::writeChannelOccupancy(GenerationType gen, int band, int antenna, int channel,
+                                         long long users) {
+    if (!isEnabled()) return;
+    beginRecord(RECORD_CHANNEL_OCCUPANCY);
+    field("generation", generationName(gen));
+    field("band", band);
+    field("antenna", antenna);
+    field("channel", channel);
+    field("users", users);
+    endRecord();
+}
+
+void ResultWriter::writeCoreCount(GenerationType gen, int messagesPerUser, int overheadPer100Messages,
+                                  long long cores) {
+    if (!isEnabled()) return;
+    beginRecord(RECORD_CORE_COUNT);
+    field("generation", generationName(gen));
+    field("messages_per_user", messagesPerUser);
+    field("overhead_per_100", overheadPer100Messages);
+    field("cores", cores);
+    endRecord();
+}
+
+void ResultWriter::writeScenarioResult(GenerationType gen, int numAntennas, int overheadPer100Messages,
+                                       int messagesPerUser, long long numUsers,
+                                       long long totalCapacity, long long cores) {
+    if (!isEnabled()) return;
+    beginRecord(RECORD_SCENARIO);
+    field("generation", generationName(gen));
+    field("antennas", numAntennas);
+    field("overhead_per_100", overheadPer100Messages);
+    field("messages_per_user", messagesPerUser);
+    field("users", numUsers);
+    field("total_capacity", totalCapacity);
+    field("cores", cores);
+    endRecord();
+}
+
+void ResultWriter::writeUserRow(GenerationType gen, long long deviceId, int channel, int antenna,
+                                int band, bool active, int messages) {
+    if (!isEnabled()) return;
+    beginRecord(RECORD_USER);
+    field("generation", generationName(gen));
+    field("device_id", deviceId);
+    field("channel", channel);
+    field("antenna", antenna);
+    field("band", band);
+    field("active", active ? 1 : 0);
+    field("messages", messages);
+    endRecord();
+}
+
+void ResultWriter::writeLatency(GenerationType gen, const char* scope, const LatencyHistogram& histogram) {
+    if (!isEnabled()) return;
+    beginRecord(RECORD_LATENCY);
+    field("generation", generationName(gen));
+    field("scope", scope);
+    field("messages", (long long)histogram.getTotalCount());
+    field("p50_ns", (long long)histogram.valueAtPerMillion(500000));
+    field("p99_ns", (long long)histogram.valueAtPerMillion(990000));
+    field("p999_ns", (long long)histogram.valueAtPerMillion(999000));
+    field("max_ns", (long long)histogram.getMax());
+    endRecord();
+}
+
+void ResultWriter::writeCorePacking(GenerationType gen, const CoreAllocation& allocation) {
+    if (!isEnabled()) return;
+    beginRecord(RECORD_CORE_PACKING);
+    field("generation", generationName(gen));
+    field("granularity", coreGranularityName(allocation.granularity));
+    field("items", allocation.items);
+    field("cores", allocation.cores);
+    field("lower_bound", allocation.lowerBound);
+    field("efficiency_permille", allocation.efficiencyPerMille);
+    field("split_groups", allocation.splitGroups);
+    field("oversized_items", allocation.oversizedItems);
+    field("solve_us", allocation.solveMicros);
+    endRecord();
+}
+
+void ResultWriter::writeAdmission(const CellTower& tower) {
+    if (!isEnabled()) return;
+    for (int cls = 0; cls < QOS_CLASS_COUNT; ++cls) {
+        const QosClass qos = static_cast<QosClass>(cls);
+        beginRecord(RECORD_ADMISSION);
+        field("generation", generationName(tower.getGeneration()));
+        field("qos_class", qosClassName(qos));
+        field("admitted", tower.getAdmittedCount(qos));
+        field("preempted", tower.getPreemptedCount(qos));
+        field("rejected", tower.getRejectedCount(qos));
+        endRecord();
+    }
+}
+
+void ResultWriter::writeSteering(SteeringPolicy policy, bool rebalancing, long long admitted, long long rejected,
+                                 long long moved, long long peakCores, long long finalCores) {
+    if (!isEnabled()) return;
+    beginRecord(RECORD_STEERING);
+    field("policy", steeringPolicyName(policy));
+    field("rebalancing", rebalancing ? 1LL : 0LL);
+    field("admitted", admitted);
+    field("rejected", rejected);
+    field("moved", moved);
+    field("peak_cores", peakCores);
+    field("final_cores", finalCores);
+    endRecord();
+}
+
+void ResultWriter::writeTowerOccupancy(const CellTower& tower) {
+    if (!isEnabled()) return;
+    const OccupancyIndex& occupancy = tower.getOccupancy();
+    for (int band = 0; band < occupancy.getNumBands(); ++band) {
+        for (int antenna = 0; antenna < occupancy.getNumAntennas(); ++antenna) {
+            for (int channel = 0; channel < occupancy.getNumChannels(); ++channel) {
+                long long users = occupancy.count(band, antenna, channel);
+                if (users == 0) continue;
+                writeChannelOccupancy(tower.getGeneration(), band, antenna, channel, users);
+            }
+        }
+    }
+}
+
+void ResultWriter::writeSaturatedCells(const CellTower& tower, int k, int thresholdPercent) {
+    if (!isEnabled()) return;
+    const OccupancyIndex& occupancy = tower.getOccupancy();
+    const std::vector<ChannelLoad> cells = occupancy.topSaturated(k, thresholdPercent);
+    for (size_t rank = 0; rank < cells.size(); ++rank) {
+        const ChannelLoad& cell = cells[rank];
+        beginRecord(RECORD_SATURATED_CELL);
+        field("generation", generationName(tower.getGeneration()));
+        field("rank", (long long)rank + 1);
+        field("band", cell.band);
+        field("antenna", cell.antenna);
+        field("channel", cell.channel);
+        field("users", cell.users);
+        field("percent_full", cell.percentFull);
+        field("antenna_users", occupancy.rangeCount(cell.antenna, cell.antenna, 0, occupancy.getNumChannels() - 1));
+        endRecord();
+    }
+}
+
+void ResultWriter::writeTowerUsers(const CellTower& tower) {
+    if (!isEnabled()) return;
+    const GenerationType gen = tower.getGeneration();
+    tower.forEachUserRun([&](long long firstId, long long run, int channel, int antenna, int band,
+                             const UserDevice* device) {
+        if (device) {
+            writeUserRow(gen, device->getDeviceId(), channel, antenna, band, device->getIsActive(),
+                         tower.getTrafficProfile(device->getTrafficClass()).messages);
+            return;
+        }
+        for (long long id = firstId; id < firstId + run; ++id) {
+            writeUserRow(gen, id, channel, antenna, band, true,
+                         tower.getTrafficProfile(tower.getTrafficClassOf(id)).messages);
+        }
+    });
+}
+
+void ResultWriter::appendBytes(const char* data, size_t length) {
+    while (length > 0) {
+        ensureRoom(1);
+        size_t chunk = std::min(length, buffer.size() - used);
+        std::memcpy(buffer.data() + used, data, chunk);
+        used += chunk;
+        data += chunk;
+        length -= chunk;
+    }
+}
+
+void ResultWriter::appendTo(ResultWriter& target) {
+    // headers the target still owes, in the order their first records appear
+    std::vector<std::pair<size_t, int>> owed;
+    for (int type = 0; type < RECORD_TYPE_COUNT; ++type) {
+        if (headerWritten[type] && !target.headerWritten[type]) owed.push_back({firstRecordOffset[type], type});
+    }
+    std::sort(owed.begin(), owed.end());
+
+    size_t copied = 0;
+    for (const auto& header : owed) {
+        target.appendBytes(buffer.data() + copied, header.first - copied);
+        copied = header.first;
+        target.ensureRoom(MAX_RECORD_BYTES);
+        target.writeHeader(static_cast<RecordType>(header.second));
+    }
+    target.appendBytes(buffer.data() + copied, used - copied);
+    used = 0;
+}
@@ -0,0 +1,116 @@
+// ResultWriter.h
+#ifndef RESULT_WRITER_H
+#define RESULT_WRITER_H
+
+#include "CellularNetwork.h"
+#include <vector>
+
+// ============================================================================
+// RESULT FORMAT - selected with --results=csv|json on the command line
+// ============================================================================
+enum ResultFormat {
+    RESULT_NONE,
+    RESULT_CSV,
+    RESULT_JSON
+};
+
+// ============================================================================
+// STRUCTURED RESULT WRITER
+// Emits machine-readable CSV rows or JSON lines for downstream tooling.
+// Numbers are formatted by hand (no iostream/printf) straight into a large
+// reusable buffer that is only handed to the kernel when it fills up.
+// CSV output is a single stream: the first column names the record type and
+// a header row is written the first time each record type appears.
+// ============================================================================
+class ResultWriter {
+public:
+    enum RecordType {
+        RECORD_TOWER_CAPACITY,
+        RECORD_CHANNEL_OCCUPANCY,
+        RECORD_CORE_COUNT,
+        RECORD_SCENARIO,
+        RECORD_USER,
+        RECORD_LATENCY,
+        RECORD_CORE_PACKING,
+        RECORD_ADMISSION,
+        RECORD_STEERING,
+        RECORD_SATURATED_CELL,
+        RECORD_TYPE_COUNT
+    };
+
+private:
+    ResultFormat format;
+    int fd;
+    bool ownsFd;
+    std::vector<char> buffer;
+    size_t used;
+    bool headerWritten[RECORD_TYPE_COUNT];
+    size_t firstRecordOffset[RECORD_TYPE_COUNT];   // in-memory mode: where a header is owed
+
+    static const size_t MAX_RECORD_BYTES = 512;
+
+    void ensureRoom(size_t bytes) {
+        if (used + bytes <= buffer.size()) return;
+        if (fd == IN_MEMORY) buffer.resize((used + bytes) * 2);
+        else flush();
+    }
+    void appendBytes(const char* data, size_t length);
+    void putChar(char c) { buffer[used++] = c; }
+    void putString(const char* text);
+    void putInt(long long value);
+
+    void writeHeader(RecordType type);
+    void beginRecord(RecordType type);
+    void field(const char* name, long long value);
+    void field(const char* name, const char* value);
+    void endRecord();
+
+public:
+    // output descriptor for a writer that only accumulates (see appendTo)
+    static const int IN_MEMORY = -1;
+
+    ResultWriter(ResultFormat fmt, int outputFd = 1, size_t bufferBytes = 4u << 20);
+    ~ResultWriter();
+
+    ResultWriter(const ResultWriter&) = delete;
+    ResultWriter& operator=(const ResultWriter&) = delete;
+
+    // Opens (truncates) path for writing; throws InvalidConfigurationException on failure.
+    static int openOutputFile(const char* path);
+
+    ResultFormat getFormat() const { return format; }
+    bool isEnabled() const { return format != RESULT_NONE; }
+
+    void writeTowerCapacity(GenerationType gen, long long totalCapacity, int numChannels,
+                            int usersPerChannel, int numAntennas);
+    void writeChannelOccupancy(GenerationType gen, int band, int antenna, int channel, long long users);
+    void writeCoreCount(GenerationType gen, int messagesPerUser, int overheadPer100Messages, long long cores);
+    void writeScenarioResult(GenerationType gen, int numAntennas, int overheadPer100Messages,
+                             int messagesPerUser, long long numUsers, long long totalCapacity,
+                             long long cores);
+    void writeUserRow(GenerationType gen, long long deviceId, int channel, int antenna, int band,
+                      bool active, int messages);
+    // scope: "tower" for one simulated tower, "generation" for the merged histogram
+    void writeLatency(GenerationType gen, const char* scope, const LatencyHistogram& histogram);
+    void writeCorePacking(GenerationType gen, const CoreAllocation& allocation);
+    // one row per QoS class from the tower's admission counters
+    void writeAdmission(const CellTower& tower);
+    // one multi-RAT site run under a steering policy
+    void writeSteering(SteeringPolicy policy, bool rebalancing, long long admitted, long long rejected,
+                       long long moved, long long peakCores, long long finalCores);
+
+    // Per-channel occupancy and (optionally) per-user rows for a populated tower.
+    void writeTowerOccupancy(const CellTower& tower);
+    // Up to k cells at or above thresholdPercent full (OccupancyIndex::topSaturated),
+    // each with the users on its antenna across every band and channel.
+    void writeSaturatedCells(const CellTower& tower, int k, int thresholdPercent);
+    void writeTowerUsers(const CellTower& tower);
+
+    void flush();
+
+    // Moves everything an IN_MEMORY writer accumulated into target, inserting
+    // CSV headers exactly where target would have written them itself.
+    void appendTo(ResultWriter& target);
+};
+
+#endif // RESULT_WRITER_H
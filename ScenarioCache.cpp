@@ -0,0 +1,304 @@
+// ScenarioCache.cpp
+#include "ScenarioCache.h"
+#include <cstddef>
+#include <cstring>
+#include <string>
+#include <fcntl.h>
+#include <sys/file.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+// ============================================================================
+// ScenarioKey
+// ============================================================================
+
+ScenarioKey ScenarioKey::describe(const CellTower& tower, int messagesPerUser, int overheadPer100Messages,
+                                  bool withLatency) {
+    ScenarioKey key;
+    key.fields[KEY_GENERATION] = tower.getGeneration();
+    key.fields[KEY_TOTAL_BANDWIDTH] = tower.getTotalBandwidth();
+    key.fields[KEY_CHANNEL_BANDWIDTH] = tower.getChannelBandwidth();
+    key.fields[KEY_USERS_PER_CHANNEL] = tower.getUsersPerChannel();
+    key.fields[KEY_ANTENNAS] = tower.getNumAntennas();
+    key.fields[KEY_EXTRA_BANDWIDTH] = tower.getExtraBandwidth();
+    key.fields[KEY_EXTRA_CHANNEL_BANDWIDTH] = tower.getNumExtraChannels() > 0 ? tower.getExtraChannelBandwidth() : 0;
+    key.fields[KEY_EXTRA_USERS_PER_CHANNEL] = tower.getNumExtraChannels() > 0 ? tower.getExtraUsersPerChannel() : 0;
+    key.fields[KEY_USERS] = tower.getNumUsers();
+    key.fields[KEY_MESSAGES_PER_USER] = messagesPerUser;
+    key.fields[KEY_OVERHEAD] = overheadPer100Messages;
+    key.fields[KEY_LATENCY] = withLatency ? 1 : 0;
+    key.fields[KEY_PLACEMENT] = tower.getPlacement();
+    for (int cls = 0; cls < TRAFFIC_CLASS_COUNT; ++cls) {
+        const TrafficProfile& profile = tower.getTrafficProfile(static_cast<TrafficClass>(cls));
+        key.fields[KEY_TRAFFIC_MIX + cls] = tower.getTrafficMix().percent[cls];
+        key.fields[KEY_TRAFFIC_MESSAGES + cls] = profile.messages;
+        key.fields[KEY_TRAFFIC_OVERHEAD + cls] = profile.overheadPer100Messages;
+    }
+    return key;
+}
+
+uint64_t ScenarioKey::hash() const {
+    uint64_t h = 0xCBF29CE484222325ULL;
+    auto mix = [&h](uint64_t value, int bytes) {
+        for (int i = 0; i < bytes; ++i) {
+            h ^= (value >> (8 * i)) & 0xFF;
+            h *= 0x100000001B3ULL;
+        }
+    };
+    mix(SIMULATION_MODEL_VERSION, 4);
+    for (int i = 0; i < KEY_FIELD_COUNT; ++i) mix((uint64_t)fields[i], 8);
+    return h;
+}
+
+bool ScenarioKey::operator==(const ScenarioKey& other) const {
+    return std::memcmp(fields, other.fields, sizeof(fields)) == 0;
+}
+
+// ============================================================================
+// On-disk layout: one header, then diskSlots fixed-size slots
+// ============================================================================
+
+static const char DISK_MAGIC[8] = {'C', 'N', 'S', 'C', 'A', 'C', 'H', 'E'};
+static const int MAX_DISK_BUCKETS = 1024;   // latency histograms with more are not stored on disk
+static const uint32_t PROBE_LIMIT = 8;
+static const uint32_t SLOT_USED = 1;
+static const uint32_t SLOT_HAS_LATENCY = 2;
+
+struct ScenarioCache::DiskHeader {
+    char magic[8];
+    uint32_t modelVersion;
+    uint32_t slotCount;
+    uint32_t slotBytes;
+    uint32_t keyFields;
+    char reserved[40];
+};
+
+struct ScenarioCache::DiskSlot {
+    uint32_t sequence;   // odd while a writer is updating the slot
+    uint32_t flags;
+    uint64_t hash;
+    int64_t key[KEY_FIELD_COUNT];
+    int64_t totalCapacity;
+    int64_t users;
+    int64_t cores;
+    uint64_t latencyMax;
+    uint32_t bucketCount;
+    uint32_t reserved;
+    uint16_t bucketIndex[MAX_DISK_BUCKETS];
+    uint32_t bucketValue[MAX_DISK_BUCKETS];
+};
+
+ScenarioCache::ScenarioCache(size_t memoryEntries)
+    : memoryCapacity(memoryEntries > 0 ? memoryEntries : 1), diskFd(-1), diskSlots(0),
+      diskMap(nullptr), diskBytes(0), memoryHits(0), diskHits(0), misses(0) {}
+
+ScenarioCache::~ScenarioCache() {
+    if (diskMap) munmap(diskMap, diskBytes);
+    if (diskFd >= 0) close(diskFd);
+}
+
+ScenarioCache::DiskSlot* ScenarioCache::slotAt(uint32_t index) const {
+    return reinterpret_cast<DiskSlot*>(static_cast<char*>(diskMap) + sizeof(DiskHeader) +
+                                       (size_t)index * sizeof(DiskSlot));
+}
+
+// Writes an empty table with header next to path and renames it over path;
+// returns the new file's descriptor, or -1.
+static int replaceDiskStore(const char* path, size_t bytes, const void* header, size_t headerBytes) {
+    const std::string temp = std::string(path) + ".tmp." + std::to_string((long)getpid());
+    int fd = open(temp.c_str(), O_RDWR | O_CREAT | O_TRUNC, 0644);
+    if (fd < 0) return -1;
+    bool written = ftruncate(fd, (off_t)bytes) == 0 &&
+                   pwrite(fd, header, headerBytes, 0) == (ssize_t)headerBytes &&
+                   rename(temp.c_str(), path) == 0;
+    if (!written) {
+        close(fd);
+        unlink(temp.c_str());
+        return -1;
+    }
+    return fd;
+}
+
+void ScenarioCache::openDiskStore(const char* path, uint32_t slots) {
+    if (slots == 0) throw InvalidConfigurationException("cache needs at least one slot");
+    const size_t bytes = sizeof(DiskHeader) + (size_t)slots * sizeof(DiskSlot);
+
+    DiskHeader expected;
+    std::memset(&expected, 0, sizeof(expected));
+    std::memcpy(expected.magic, DISK_MAGIC, sizeof(DISK_MAGIC));
+    expected.modelVersion = SIMULATION_MODEL_VERSION;
+    expected.slotCount = slots;
+    expected.slotBytes = (uint32_t)sizeof(DiskSlot);
+    expected.keyFields = KEY_FIELD_COUNT;
+
+    // A file from another model version or layout is replaced, not truncated:
+    // processes still mapping it keep their (now unlinked) copy instead of
+    // faulting on pages cut off under them.
+    int fd;
+    for (;;) {
+        fd = open(path, O_RDWR | O_CREAT, 0644);
+        if (fd < 0) throw InvalidConfigurationException("cannot open cache file");
+        flock(fd, LOCK_EX);
+        // another process may have replaced the file while we waited for the lock
+        struct stat info, current;
+        if (fstat(fd, &info) != 0 || stat(path, &current) != 0 ||
+            info.st_dev != current.st_dev || info.st_ino != current.st_ino) {
+            close(fd);
+            continue;
+        }
+        DiskHeader found;
+        bool valid = (size_t)info.st_size == bytes &&
+                     pread(fd, &found, sizeof(found), 0) == (ssize_t)sizeof(found) &&
+                     std::memcmp(&found, &expected, sizeof(found)) == 0;
+        if (!valid) {
+            int fresh = replaceDiskStore(path, bytes, &expected, sizeof(expected));
+            if (fresh < 0) {
+                close(fd);
+                throw InvalidConfigurationException("cannot initialise cache file");
+            }
+            close(fd);   // releases the lock on the replaced file
+            fd = fresh;
+        } else {
+            flock(fd, LOCK_UN);
+        }
+        break;
+    }
+
+    void* map = mmap(nullptr, bytes, PROT_READ | PROT_WRITE, MAP_SHARED, fd, 0);
+    if (map == MAP_FAILED) {
+        close(fd);
+        throw InvalidConfigurationException("cannot map cache file");
+    }
+
+    std::lock_guard<std::mutex> guard(lock);
+    if (diskMap) munmap(diskMap, diskBytes);
+    if (diskFd >= 0) close(diskFd);
+    diskFd = fd;
+    diskSlots = slots;
+    diskMap = map;
+    diskBytes = bytes;
+}
+
+// ============================================================================
+// Lookup / store
+// ============================================================================
+
+bool ScenarioCache::lookup(const ScenarioKey& key, ScenarioResult& result) {
+    const uint64_t hash = key.hash();
+    std::lock_guard<std::mutex> guard(lock);
+
+    auto found = byHash.find(hash);
+    if (found != byHash.end() && found->second->key == key) {
+        lru.splice(lru.begin(), lru, found->second);
+        result = found->second->result;
+        ++memoryHits;
+        return true;
+    }
+    if (diskMap && loadFromDisk(key, hash, result)) {
+        rememberLocked(key, result, hash);
+        ++diskHits;
+        return true;
+    }
+    ++misses;
+    return false;
+}
+
+void ScenarioCache::store(const ScenarioKey& key, const ScenarioResult& result) {
+    const uint64_t hash = key.hash();
+    std::lock_guard<std::mutex> guard(lock);
+    rememberLocked(key, result, hash);
+    if (diskMap) storeOnDisk(key, hash, result);
+}
+
+void ScenarioCache::rememberLocked(const ScenarioKey& key, const ScenarioResult& result, uint64_t hash) {
+    auto found = byHash.find(hash);
+    if (found != byHash.end()) {
+        // same key refreshed, or a hash collision evicting the older key
+        found->second->key = key;
+        found->second->result = result;
+        lru.splice(lru.begin(), lru, found->second);
+        return;
+    }
+    lru.push_front({key, result});
+    byHash[hash] = lru.begin();
+    if (lru.size() > memoryCapacity) {
+        byHash.erase(lru.back().key.hash());
+        lru.pop_back();
+    }
+}
+
+// Seqlock read: copy the slot, then accept it only if the sequence number
+// was even and unchanged across the copy.
+bool ScenarioCache::loadFromDisk(const ScenarioKey& key, uint64_t hash, ScenarioResult& result) const {
+    // everything before the bucket arrays, copied first to check for a match
+    const size_t headBytes = offsetof(DiskSlot, bucketIndex);
+    std::unique_ptr<DiskSlot> copy(new DiskSlot());
+    for (uint32_t probe = 0; probe < PROBE_LIMIT && probe < diskSlots; ++probe) {
+        DiskSlot* slot = slotAt((uint32_t)((hash + probe) % diskSlots));
+        uint32_t before = __atomic_load_n(&slot->sequence, __ATOMIC_ACQUIRE);
+        if (before & 1) continue;   // being written; treat as a miss for this slot
+        std::memcpy(copy.get(), slot, headBytes);
+        if (!(copy->flags & SLOT_USED)) return false;   // probe chains end at an empty slot
+        if (copy->hash != hash || std::memcmp(copy->key, key.fields, sizeof(key.fields)) != 0) continue;
+        uint32_t buckets = copy->bucketCount > (uint32_t)MAX_DISK_BUCKETS ? 0 : copy->bucketCount;
+        std::memcpy(copy->bucketIndex, slot->bucketIndex, buckets * sizeof(uint16_t));
+        std::memcpy(copy->bucketValue, slot->bucketValue, buckets * sizeof(uint32_t));
+        __atomic_thread_fence(__ATOMIC_ACQUIRE);
+        if (__atomic_load_n(&slot->sequence, __ATOMIC_RELAXED) != before) continue;
+
+        result.totalCapacity = copy->totalCapacity;
+        result.users = copy->users;
+        result.cores = copy->cores;
+        result.latency.reset();
+        if (copy->flags & SLOT_HAS_LATENCY) {
+            std::shared_ptr<LatencyHistogram> latency(new LatencyHistogram());
+            for (uint32_t i = 0; i < buckets; ++i) latency->addToBucket(copy->bucketIndex[i], copy->bucketValue[i]);
+            latency->raiseMax(copy->latencyMax);
+            result.latency = latency;
+        }
+        return true;
+    }
+    return false;
+}
+
+void ScenarioCache::storeOnDisk(const ScenarioKey& key, uint64_t hash, const ScenarioResult& result) {
+    std::unique_ptr<DiskSlot> entry(new DiskSlot());
+    std::memset(entry.get(), 0, sizeof(DiskSlot));
+    entry->flags = SLOT_USED;
+    entry->hash = hash;
+    std::memcpy(entry->key, key.fields, sizeof(key.fields));
+    entry->totalCapacity = result.totalCapacity;
+    entry->users = result.users;
+    entry->cores = result.cores;
+    if (result.latency) {
+        int buckets = result.latency->exportBuckets(entry->bucketIndex, entry->bucketValue, MAX_DISK_BUCKETS);
+        if (buckets < 0) return;   // too wide to store; stays in the in-process layer only
+        entry->flags |= SLOT_HAS_LATENCY;
+        entry->bucketCount = (uint32_t)buckets;
+        entry->latencyMax = result.latency->getMax();
+    }
+
+    flock(diskFd, LOCK_EX);
+    // the slot already holding this key, else the first free one, else the home slot
+    uint32_t target = (uint32_t)(hash % diskSlots);
+    for (uint32_t probe = 0; probe < PROBE_LIMIT && probe < diskSlots; ++probe) {
+        uint32_t index = (uint32_t)((hash + probe) % diskSlots);
+        DiskSlot* slot = slotAt(index);
+        if (!(slot->flags & SLOT_USED) ||
+            (slot->hash == hash && std::memcmp(slot->key, key.fields, sizeof(key.fields)) == 0)) {
+            target = index;
+            break;
+        }
+    }
+
+    DiskSlot* slot = slotAt(target);
+    uint32_t sequence = slot->sequence;
+    __atomic_store_n(&slot->sequence, sequence + 1, __ATOMIC_RELAXED);
+    __atomic_thread_fence(__ATOMIC_RELEASE);
+    std::memcpy(reinterpret_cast<char*>(slot) + sizeof(uint32_t),
+                reinterpret_cast<const char*>(entry.get()) + sizeof(uint32_t),
+                sizeof(DiskSlot) - sizeof(uint32_t));
+    __atomic_store_n(&slot->sequence, sequence + 2, __ATOMIC_RELEASE);
+    flock(diskFd, LOCK_UN);
+}
@@ -0,0 +1,118 @@
+// ScenarioCache.h
+#ifndef SCENARIO_CACHE_H
+#define SCENARIO_CACHE_H
+
+#include "CellularNetwork.h"
+#include <cstdint>
+#include <list>
+#include <memory>
+#include <mutex>
+#include <unordered_map>
+
+// Bump whenever a change alters simulated results (capacity, core or latency
+// model, traffic defaults); cached results of other versions are discarded.
+static const uint32_t SIMULATION_MODEL_VERSION = 3;
+
+// ============================================================================
+// SCENARIO KEY - canonical description of one analysed tower: every input
+// that changes its results, as fixed-order 64-bit fields (see ScenarioField)
+// ============================================================================
+enum ScenarioField {
+    KEY_GENERATION,
+    KEY_TOTAL_BANDWIDTH,
+    KEY_CHANNEL_BANDWIDTH,
+    KEY_USERS_PER_CHANNEL,
+    KEY_ANTENNAS,
+    KEY_EXTRA_BANDWIDTH,
+    KEY_EXTRA_CHANNEL_BANDWIDTH,
+    KEY_EXTRA_USERS_PER_CHANNEL,
+    KEY_USERS,
+    KEY_MESSAGES_PER_USER,
+    KEY_OVERHEAD,
+    KEY_LATENCY,                                      // 1 when latency is simulated
+    KEY_PLACEMENT,                                    // PlacementModel
+    KEY_TRAFFIC_MIX,                                  // TRAFFIC_CLASS_COUNT shares
+    KEY_TRAFFIC_MESSAGES = KEY_TRAFFIC_MIX + TRAFFIC_CLASS_COUNT,
+    KEY_TRAFFIC_OVERHEAD = KEY_TRAFFIC_MESSAGES + TRAFFIC_CLASS_COUNT,
+    KEY_FIELD_COUNT = KEY_TRAFFIC_OVERHEAD + TRAFFIC_CLASS_COUNT
+};
+
+struct ScenarioKey {
+    int64_t fields[KEY_FIELD_COUNT];
+
+    static ScenarioKey describe(const CellTower& tower, int messagesPerUser, int overheadPer100Messages,
+                                bool withLatency);
+
+    // FNV-1a over the fields' little-endian bytes, seeded with the model version
+    uint64_t hash() const;
+    bool operator==(const ScenarioKey& other) const;
+};
+
+struct ScenarioResult {
+    long long totalCapacity;
+    long long users;
+    long long cores;
+    std::shared_ptr<const LatencyHistogram> latency;   // null unless simulated
+};
+
+// ============================================================================
+// SCENARIO CACHE
+// In-process LRU of analysed scenarios, optionally backed by an mmap-ed file
+// shared between runs and concurrent jobs. The file is a fixed open-addressing
+// table; each slot is guarded by a sequence counter so readers never see a
+// half-written entry, and writers serialise on flock(). A file written by
+// another model version (or with another layout) is wiped when opened.
+// Thread-safe.
+// ============================================================================
+class ScenarioCache {
+public:
+    static const size_t DEFAULT_MEMORY_ENTRIES = 256;
+    static const uint32_t DEFAULT_DISK_SLOTS = 1024;
+
+private:
+    struct MemoryEntry {
+        ScenarioKey key;
+        ScenarioResult result;
+    };
+    struct DiskHeader;
+    struct DiskSlot;
+
+    size_t memoryCapacity;
+    std::list<MemoryEntry> lru;                                   // most recent first
+    std::unordered_map<uint64_t, std::list<MemoryEntry>::iterator> byHash;
+    mutable std::mutex lock;
+
+    int diskFd;
+    uint32_t diskSlots;
+    void* diskMap;
+    size_t diskBytes;
+
+    long long memoryHits;
+    long long diskHits;
+    long long misses;
+
+    void rememberLocked(const ScenarioKey& key, const ScenarioResult& result, uint64_t hash);
+    bool loadFromDisk(const ScenarioKey& key, uint64_t hash, ScenarioResult& result) const;
+    void storeOnDisk(const ScenarioKey& key, uint64_t hash, const ScenarioResult& result);
+    DiskSlot* slotAt(uint32_t index) const;
+
+public:
+    explicit ScenarioCache(size_t memoryEntries = DEFAULT_MEMORY_ENTRIES);
+    ~ScenarioCache();
+
+    ScenarioCache(const ScenarioCache&) = delete;
+    ScenarioCache& operator=(const ScenarioCache&) = delete;
+
+    // Maps (creating if needed) the on-disk store at path. Throws
+    // InvalidConfigurationException when the file cannot be opened or mapped.
+    void openDiskStore(const char* path, uint32_t slots = DEFAULT_DISK_SLOTS);
+
+    bool lookup(const ScenarioKey& key, ScenarioResult& result);
+    void store(const ScenarioKey& key, const ScenarioResult& result);
+
+    long long getMemoryHits() const { return memoryHits; }
+    long long getDiskHits() const { return diskHits; }
+    long long getMisses() const { return misses; }
+};
+
+#endif // SCENARIO_CACHE_H
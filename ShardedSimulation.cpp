@@ -0,0 +1,432 @@
+// ShardedSimulation.cpp
+#include "ShardedSimulation.h"
+#include "ResultWriter.h"
+#include "StatsServer.h"
+#include "basicIO.h"
+#include <fcntl.h>
+#include <new>
+#include <sched.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <sys/mman.h>
+#include <sys/wait.h>
+#include <unistd.h>
+
+extern basicIO io;
+
+// ============================================================================
+// SpscRing
+// ============================================================================
+
+void SpscRing::attach(void* memory, size_t slotCount, bool initialise) {
+    if (initialise) header = new (memory) Header();
+    else header = static_cast<Header*>(memory);
+    if (initialise) {
+        header->head.store(0, std::memory_order_relaxed);
+        header->tail.store(0, std::memory_order_relaxed);
+    }
+    slots = reinterpret_cast<ShardMessage*>(static_cast<char*>(memory) + sizeof(Header));
+    mask = slotCount - 1;
+}
+
+bool SpscRing::tryPush(const ShardMessage& msg) {
+    const uint64_t tail = header->tail.load(std::memory_order_relaxed);
+    const uint64_t head = header->head.load(std::memory_order_acquire);
+    if (tail - head > mask) return false;  // full
+    slots[tail & mask] = msg;
+    header->tail.store(tail + 1, std::memory_order_release);
+    return true;
+}
+
+bool SpscRing::tryPop(ShardMessage& msg) {
+    const uint64_t head = header->head.load(std::memory_order_relaxed);
+    const uint64_t tail = header->tail.load(std::memory_order_acquire);
+    if (head == tail) return false;  // empty
+    msg = slots[head & mask];
+    header->head.store(head + 1, std::memory_order_release);
+    return true;
+}
+
+// ============================================================================
+// SharedMemoryTransport
+// ============================================================================
+
+SharedMemoryTransport::SharedMemoryTransport(int shards, size_t slotsPerRing)
+    : numShards(shards), region(nullptr), regionBytes(0), states(nullptr) {
+    if (numShards < 1) throw InvalidConfigurationException("shard count must be positive");
+    if (slotsPerRing < 2 || (slotsPerRing & (slotsPerRing - 1)) != 0) {
+        throw InvalidConfigurationException("ring size must be a power of two");
+    }
+
+    const size_t endpoints = (size_t)numShards + 1;
+    const size_t ringCount = (size_t)numShards * endpoints;
+    const size_t ringBytes = SpscRing::bytesNeeded(slotsPerRing);
+    // shard state block, padded so the first ring header starts on its own cache line
+    const size_t stateBytes = ((sizeof(std::atomic<int32_t>) * numShards + 63) / 64) * 64;
+    regionBytes = stateBytes + ringCount * ringBytes;
+
+    region = mmap(nullptr, regionBytes, PROT_READ | PROT_WRITE, MAP_SHARED | MAP_ANONYMOUS, -1, 0);
+    if (region == MAP_FAILED) {
+        region = nullptr;
+        throw NetworkException("cannot map shared memory for shards");
+    }
+
+    states = static_cast<std::atomic<int32_t>*>(region);
+    for (int i = 0; i < numShards; ++i) new (&states[i]) std::atomic<int32_t>(SHARD_RUNNING);
+
+    rings.resize(ringCount);
+    char* cursor = static_cast<char*>(region) + stateBytes;
+    for (size_t i = 0; i < ringCount; ++i, cursor += ringBytes) rings[i].attach(cursor, slotsPerRing, true);
+    receiveCursor.assign(endpoints, 0);
+}
+
+SharedMemoryTransport::~SharedMemoryTransport() {
+    if (region) munmap(region, regionBytes);
+}
+
+bool SharedMemoryTransport::trySend(int fromShard, int toEndpoint, const ShardMessage& msg) {
+    return ring(fromShard, toEndpoint).tryPush(msg);
+}
+
+bool SharedMemoryTransport::tryReceive(int endpoint, ShardMessage& msg) {
+    // rotate the starting producer so one busy shard cannot starve the others
+    int start = receiveCursor[endpoint];
+    for (int i = 0; i < numShards; ++i) {
+        int from = (start + i) % numShards;
+        if (ring(from, endpoint).tryPop(msg)) {
+            receiveCursor[endpoint] = (from + 1) % numShards;
+            return true;
+        }
+    }
+    return false;
+}
+
+void SharedMemoryTransport::setShardState(int shard, ShardState state) {
+    states[shard].store(state, std::memory_order_release);
+}
+
+ShardState SharedMemoryTransport::getShardState(int shard) const {
+    return static_cast<ShardState>(states[shard].load(std::memory_order_acquire));
+}
+
+// ============================================================================
+// ShardCoordinator
+// ============================================================================
+
+ShardCoordinator::ShardCoordinator(const ShardedRunOptions& opts, const CellularNetworkSimulator& sim,
+                                   ResultWriter* writer)
+    : options(opts), simulator(sim), results(writer), stats(sim.getStats()) {
+    if (options.numShards < 1) throw InvalidConfigurationException("shard count must be positive");
+    if (options.towersPerGeneration < 1) throw InvalidConfigurationException("towers per generation must be positive");
+    if (options.loadPercent < 0 || options.loadPercent > 100) throw InvalidConfigurationException("load must be 0-100");
+    if (options.handoverPercent < 0 || options.handoverPercent > 100) {
+        throw InvalidConfigurationException("handover share must be 0-100");
+    }
+}
+
+// next tower of the same generation, wrapping around
+int ShardCoordinator::neighbourOf(int towerIndex) const {
+    int first = (towerIndex / options.towersPerGeneration) * options.towersPerGeneration;
+    return first + (towerIndex - first + 1) % options.towersPerGeneration;
+}
+
+void ShardCoordinator::handleWorkerMessage(const ShardMessage& msg,
+                                           std::vector<std::shared_ptr<CellTower>>& towers,
+                                           std::vector<ShardMessage>& towerStats,
+                                           std::vector<bool>& doneFrom) const {
+    if (msg.type == MSG_HANDOVERS_DONE) {
+        doneFrom[msg.sourceShard] = true;
+        return;
+    }
+    if (msg.type != MSG_HANDOVER) return;
+
+    CellTower& tower = *towers[msg.towerIndex];
+    long long headroom = tower.getTotalCapacity() - tower.getNumUsers();
+    long long admitted = msg.values[0] < headroom ? msg.values[0] : headroom;
+    tower.populate(tower.getNumUsers() + admitted);
+    towerStats[msg.towerIndex].values[RESULT_HANDOVERS_IN] += admitted;
+    towerStats[msg.towerIndex].values[RESULT_HANDOVERS_REJECTED] += msg.values[0] - admitted;
+}
+
+// Pushes msg, draining our own inbox while the destination is full so two
+// shards flooding each other cannot deadlock. Messages to failed shards are dropped.
+void ShardCoordinator::sendOrDrain(int shard, int toEndpoint, const ShardMessage& msg,
+                                   ShardTransport& transport,
+                                   std::vector<std::shared_ptr<CellTower>>& towers,
+                                   std::vector<ShardMessage>& towerStats,
+                                   std::vector<bool>& doneFrom) const {
+    while (!transport.trySend(shard, toEndpoint, msg)) {
+        if (toEndpoint < transport.getNumShards() && transport.getShardState(toEndpoint) == SHARD_FAILED) return;
+        ShardMessage incoming;
+        if (transport.tryReceive(shard, incoming)) handleWorkerMessage(incoming, towers, towerStats, doneFrom);
+        else sched_yield();
+    }
+}
+
+// Reads a sysfs list such as "0-3,8-11" into set; false if path is missing.
+static bool readCpuList(const char* path, cpu_set_t& set) {
+    int fd = open(path, O_RDONLY);
+    if (fd < 0) return false;
+    char text[4096];
+    long bytes = read(fd, text, sizeof(text) - 1);
+    close(fd);
+    if (bytes <= 0) return false;
+    text[bytes] = '\0';
+
+    CPU_ZERO(&set);
+    char* cursor = text;
+    while (*cursor >= '0' && *cursor <= '9') {
+        long first = strtol(cursor, &cursor, 10);
+        long last = first;
+        if (*cursor == '-') last = strtol(cursor + 1, &cursor, 10);
+        for (long cpu = first; cpu <= last && cpu < CPU_SETSIZE; ++cpu) CPU_SET(cpu, &set);
+        if (*cursor == ',') ++cursor;
+    }
+    return CPU_COUNT(&set) > 0;
+}
+
+// Binds the calling worker to every CPU of one NUMA node, shards taking the
+// online nodes in turn, so memory first touched after the fork stays local to
+// the node. Without NUMA information in sysfs the worker is left unpinned.
+static void bindToNumaNode(int shard) {
+    cpu_set_t nodes;
+    if (!readCpuList("/sys/devices/system/node/online", nodes)) return;
+    int pick = shard % CPU_COUNT(&nodes);
+    int node = 0;
+    while (!CPU_ISSET(node, &nodes) || pick-- > 0) ++node;
+
+    char path[64];
+    snprintf(path, sizeof(path), "/sys/devices/system/node/node%d/cpulist", node);
+    cpu_set_t mask;
+    if (readCpuList(path, mask)) sched_setaffinity(0, sizeof(mask), &mask);
+}
+
+void ShardCoordinator::runWorker(int shard, ShardTransport& transport) const {
+    bindToNumaNode(shard);
+
+    const int numTowers = getNumTowers();
+    const int numShards = transport.getNumShards();
+    std::vector<std::shared_ptr<CellTower>> towers(numTowers);
+    std::vector<ShardMessage> towerStats(numTowers, ShardMessage());
+    std::vector<bool> doneFrom(numShards, false);
+
+    for (int t = shard; t < numTowers; t += numShards) {
+        GenerationType gen = generationOf(t);
+        towers[t] = simulator.configureTower(gen);
+        towers[t]->populate(towers[t]->getTotalCapacity() * options.loadPercent / 100);
+    }
+
+    // hand a share of every owned tower's users to its neighbour
+    for (int t = shard; t < numTowers; t += numShards) {
+        ShardMessage handover = ShardMessage();
+        handover.type = MSG_HANDOVER;
+        handover.sourceShard = shard;
+        handover.towerIndex = neighbourOf(t);
+        handover.generation = generationOf(t);
+        handover.values[0] = towers[t]->getNumUsers() * options.handoverPercent / 100;
+        if (handover.values[0] == 0) continue;
+        towerStats[t].values[RESULT_HANDOVERS_OUT] += handover.values[0];
+
+        // the departing users leave this tower before the target admits them
+        towers[t]->releaseUsers(handover.values[0]);
+
+        int owner = ownerOf(handover.towerIndex);
+        if (owner == shard) handleWorkerMessage(handover, towers, towerStats, doneFrom);
+        else sendOrDrain(shard, owner, handover, transport, towers, towerStats, doneFrom);
+    }
+
+    ShardMessage done = ShardMessage();
+    done.type = MSG_HANDOVERS_DONE;
+    done.sourceShard = shard;
+    for (int peer = 0; peer < numShards; ++peer) {
+        if (peer != shard) sendOrDrain(shard, peer, done, transport, towers, towerStats, doneFrom);
+    }
+
+    // wait until every live peer has finished handing over to us
+    doneFrom[shard] = true;
+    for (;;) {
+        ShardMessage incoming;
+        while (transport.tryReceive(shard, incoming)) handleWorkerMessage(incoming, towers, towerStats, doneFrom);
+        bool waiting = false;
+        for (int peer = 0; peer < numShards; ++peer) {
+            if (!doneFrom[peer] && transport.getShardState(peer) != SHARD_FAILED) waiting = true;
+        }
+        if (!waiting) break;
+        sched_yield();
+    }
+
+    const int coordinator = transport.getCoordinatorEndpoint();
+    for (int t = shard; t < numTowers; t += numShards) {
+        ShardMessage result = towerStats[t];
+        GenerationType gen = generationOf(t);
+        result.type = MSG_TOWER_RESULT;
+        result.sourceShard = shard;
+        result.towerIndex = t;
+        result.generation = gen;
+        result.values[RESULT_CAPACITY] = towers[t]->getTotalCapacity();
+        result.values[RESULT_USERS] = towers[t]->getNumUsers();
+        result.values[RESULT_CORES] = towers[t]->calculateCoresForTraffic(0);
+        sendOrDrain(shard, coordinator, result, transport, towers, towerStats, doneFrom);
+    }
+
+    ShardMessage finished = ShardMessage();
+    finished.type = MSG_SHARD_DONE;
+    finished.sourceShard = shard;
+    sendOrDrain(shard, coordinator, finished, transport, towers, towerStats, doneFrom);
+    transport.setShardState(shard, SHARD_DONE);
+}
+
+void ShardCoordinator::run() {
+    const int numShards = options.numShards;
+    const int numTowers = getNumTowers();
+
+    SharedMemoryTransport transport(numShards);
+    if (results) results->flush();  // nothing buffered may be inherited by the workers
+
+    std::vector<pid_t> pids(numShards, -1);
+    for (int shard = 0; shard < numShards; ++shard) {
+        pid_t pid = fork();
+        if (pid < 0) {
+            transport.setShardState(shard, SHARD_FAILED);
+            continue;
+        }
+        if (pid == 0) {
+            int status = 0;
+            try {
+                runWorker(shard, transport);
+            } catch (const std::exception& e) {
+                io.errorstring("Shard error: ");
+                io.errorstring(e.what());
+                io.errorstring("\n");
+                status = 1;
+            }
+            _exit(status);  // skip the parent's destructors and atexit handlers
+        }
+        pids[shard] = pid;
+    }
+
+    // gather results while watching for crashed workers
+    std::vector<ShardMessage> towerResults(numTowers, ShardMessage());
+    std::vector<bool> haveResult(numTowers, false);
+    std::vector<bool> shardFinished(numShards, false);
+    std::vector<int> exitStatus(numShards, 0);
+    int running = 0;
+    for (int shard = 0; shard < numShards; ++shard) if (pids[shard] > 0) ++running;
+
+    const int coordinator = transport.getCoordinatorEndpoint();
+    for (;;) {
+        ShardMessage msg;
+        bool received = false;
+        while (transport.tryReceive(coordinator, msg)) {
+            received = true;
+            if (msg.type == MSG_TOWER_RESULT) {
+                towerResults[msg.towerIndex] = msg;
+                haveResult[msg.towerIndex] = true;
+                if (stats) {
+                    stats->recordPopulated(msg.values[RESULT_USERS]);
+                    stats->recordTower(msg.values[RESULT_CORES]);
+                    stats->recordHandoverRejections(msg.values[RESULT_HANDOVERS_REJECTED]);
+                }
+            } else if (msg.type == MSG_SHARD_DONE) {
+                shardFinished[msg.sourceShard] = true;
+            }
+        }
+        if (running == 0) break;
+
+        int status = 0;
+        pid_t pid = waitpid(-1, &status, WNOHANG);
+        if (pid > 0) {
+            for (int shard = 0; shard < numShards; ++shard) {
+                if (pids[shard] != pid) continue;
+                --running;
+                exitStatus[shard] = status;
+                bool clean = WIFEXITED(status) && WEXITSTATUS(status) == 0;
+                if (!clean) transport.setShardState(shard, SHARD_FAILED);
+            }
+        } else if (!received) {
+            usleep(200);
+        }
+    }
+
+    // ---- summary ----
+    io.outputstring("\n========== SHARDED SIMULATION ==========");
+    io.terminate();
+    io.outputstring("Shards: ");
+    io.outputint(numShards);
+    io.outputstring(", towers: ");
+    io.outputint(numTowers);
+    io.outputstring(" (");
+    io.outputint(options.towersPerGeneration);
+    io.outputstring(" per generation), load: ");
+    io.outputint(options.loadPercent);
+    io.outputstring("%, handover: ");
+    io.outputint(options.handoverPercent);
+    io.outputstring("%");
+    io.terminate();
+
+    long long totalUsers = 0, totalCores = 0;
+    for (int t = 0; t < numTowers; ++t) {
+        io.outputstring("Tower ");
+        io.outputint(t);
+        io.outputstring(" (");
+        io.outputstring(generationName(generationOf(t)));
+        io.outputstring(", shard ");
+        io.outputint(ownerOf(t));
+        io.outputstring("): ");
+        if (!haveResult[t]) {
+            io.outputstring("no result (shard failed)");
+            io.terminate();
+            continue;
+        }
+        const ShardMessage& r = towerResults[t];
+        io.outputstring("users ");
+        io.outputlong(r.values[RESULT_USERS]);
+        io.outputstring("/");
+        io.outputlong(r.values[RESULT_CAPACITY]);
+        io.outputstring(", handovers out ");
+        io.outputlong(r.values[RESULT_HANDOVERS_OUT]);
+        io.outputstring(", in ");
+        io.outputlong(r.values[RESULT_HANDOVERS_IN]);
+        io.outputstring(" (rejected ");
+        io.outputlong(r.values[RESULT_HANDOVERS_REJECTED]);
+        io.outputstring("), cores ");
+        io.outputlong(r.values[RESULT_CORES]);
+        io.terminate();
+
+        totalUsers += r.values[RESULT_USERS];
+        totalCores += r.values[RESULT_CORES];
+        if (results) {
+            GenerationType gen = generationOf(t);
+            results->writeScenarioResult(gen, simulator.getTowerConfig(gen).numAntennas, 0,
+                                         defaultMessagesPerUser(gen), r.values[RESULT_USERS],
+                                         r.values[RESULT_CAPACITY], r.values[RESULT_CORES]);
+        }
+    }
+
+    for (int shard = 0; shard < numShards; ++shard) {
+        if (shardFinished[shard] && transport.getShardState(shard) != SHARD_FAILED) continue;
+        io.outputstring("Shard ");
+        io.outputint(shard);
+        io.outputstring(" FAILED");
+        if (pids[shard] < 0) {
+            io.outputstring(" (fork failed)");
+        } else if (WIFSIGNALED(exitStatus[shard])) {
+            io.outputstring(" (signal ");
+            io.outputint(WTERMSIG(exitStatus[shard]));
+            io.outputstring(")");
+        } else {
+            io.outputstring(" (exit status ");
+            io.outputint(WEXITSTATUS(exitStatus[shard]));
+            io.outputstring(")");
+        }
+        io.outputstring(" - its towers are missing from the totals");
+        io.terminate();
+    }
+
+    io.outputstring("Total users: ");
+    io.outputlong(totalUsers);
+    io.outputstring(", total cores: ");
+    io.outputlong(totalCores);
+    io.terminate();
+    if (results) results->flush();
+}
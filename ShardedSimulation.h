@@ -0,0 +1,167 @@
+// ShardedSimulation.h
+#ifndef SHARDED_SIMULATION_H
+#define SHARDED_SIMULATION_H
+
+#include "CellularNetwork.h"
+#include <atomic>
+#include <cstddef>
+#include <cstdint>
+#include <vector>
+
+class ResultWriter;
+
+// ============================================================================
+// SHARD MESSAGES - fixed-size records exchanged between processes
+// ============================================================================
+enum ShardMessageType {
+    MSG_HANDOVER,        // values[0] = users handed over into towerIndex
+    MSG_HANDOVERS_DONE,  // sender will not send any more handovers
+    MSG_TOWER_RESULT,    // values: see TowerResultField
+    MSG_SHARD_DONE       // sender has reported every tower it owns
+};
+
+enum TowerResultField {
+    RESULT_CAPACITY,
+    RESULT_USERS,
+    RESULT_CORES,
+    RESULT_HANDOVERS_IN,
+    RESULT_HANDOVERS_REJECTED,
+    RESULT_HANDOVERS_OUT,
+    RESULT_FIELD_COUNT
+};
+
+struct ShardMessage {
+    int32_t type;
+    int32_t sourceShard;
+    int32_t towerIndex;     // global tower index the message refers to
+    int32_t generation;
+    int64_t values[RESULT_FIELD_COUNT];
+};
+
+enum ShardState {
+    SHARD_RUNNING,
+    SHARD_DONE,
+    SHARD_FAILED
+};
+
+// ============================================================================
+// SHARD TRANSPORT - how shards and the coordinator talk to each other.
+// Endpoints 0..N-1 are the worker shards, endpoint N is the coordinator.
+// Sends and receives never block; callers poll. A local-socket transport
+// can implement the same interface without touching the shard logic.
+// ============================================================================
+class ShardTransport {
+public:
+    virtual ~ShardTransport() {}
+
+    virtual int getNumShards() const = 0;
+    int getCoordinatorEndpoint() const { return getNumShards(); }
+
+    // false when the destination's inbox is full; retry after draining your own
+    virtual bool trySend(int fromShard, int toEndpoint, const ShardMessage& msg) = 0;
+    virtual bool tryReceive(int endpoint, ShardMessage& msg) = 0;
+
+    virtual void setShardState(int shard, ShardState state) = 0;
+    virtual ShardState getShardState(int shard) const = 0;
+};
+
+// ============================================================================
+// SPSC RING - lock-free single-producer/single-consumer queue whose header
+// and slots live in caller-provided (shared) memory
+// ============================================================================
+class SpscRing {
+public:
+    struct alignas(64) Header {
+        std::atomic<uint64_t> head;   // next slot to read (consumer-owned)
+        char padHead[64 - sizeof(std::atomic<uint64_t>)];
+        std::atomic<uint64_t> tail;   // next slot to write (producer-owned)
+        char padTail[64 - sizeof(std::atomic<uint64_t>)];
+    };
+
+private:
+    Header* header;
+    ShardMessage* slots;
+    uint64_t mask;
+
+public:
+    SpscRing() : header(nullptr), slots(nullptr), mask(0) {}
+
+    // slotCount must be a power of two
+    static size_t bytesNeeded(size_t slotCount) { return sizeof(Header) + slotCount * sizeof(ShardMessage); }
+    void attach(void* memory, size_t slotCount, bool initialise);
+
+    bool tryPush(const ShardMessage& msg);
+    bool tryPop(ShardMessage& msg);
+};
+
+// ============================================================================
+// SHARED MEMORY TRANSPORT - one SPSC ring per (worker, endpoint) pair in an
+// anonymous MAP_SHARED region created before the workers are forked
+// ============================================================================
+class SharedMemoryTransport : public ShardTransport {
+private:
+    int numShards;
+    void* region;
+    size_t regionBytes;
+    std::atomic<int32_t>* states;
+    std::vector<SpscRing> rings;           // rings[from * (numShards + 1) + to]
+    std::vector<int> receiveCursor;        // per endpoint round-robin start (process-local)
+
+    SpscRing& ring(int from, int to) { return rings[(size_t)from * (numShards + 1) + to]; }
+public:
+    SharedMemoryTransport(int shards, size_t slotsPerRing = 1024);
+    ~SharedMemoryTransport();
+
+    SharedMemoryTransport(const SharedMemoryTransport&) = delete;
+    SharedMemoryTransport& operator=(const SharedMemoryTransport&) = delete;
+
+    int getNumShards() const override { return numShards; }
+    bool trySend(int fromShard, int toEndpoint, const ShardMessage& msg) override;
+    bool tryReceive(int endpoint, ShardMessage& msg) override;
+    void setShardState(int shard, ShardState state) override;
+    ShardState getShardState(int shard) const override;
+};
+
+// ============================================================================
+// SHARD COORDINATOR
+// Partitions towers round-robin across N forked worker processes. Each worker
+// populates its own towers, hands a share of every tower's users over to the
+// next tower of the same generation (possibly in another shard) and reports
+// per-tower results back. A crashed worker only loses its own towers.
+// ============================================================================
+struct ShardedRunOptions {
+    int numShards = 2;
+    int towersPerGeneration = 1;
+    int loadPercent = 80;        // initial population as a share of capacity
+    int handoverPercent = 5;     // share of each tower's users handed to its neighbour
+};
+
+class ShardCoordinator {
+private:
+    ShardedRunOptions options;
+    const CellularNetworkSimulator& simulator;   // builds the workers' towers
+    ResultWriter* results;
+    SimulationStats* stats;
+
+    int getNumTowers() const { return options.towersPerGeneration * 4; }
+    int ownerOf(int towerIndex) const { return towerIndex % options.numShards; }
+    GenerationType generationOf(int towerIndex) const {
+        return static_cast<GenerationType>(towerIndex / options.towersPerGeneration);
+    }
+    int neighbourOf(int towerIndex) const;
+
+    void runWorker(int shard, ShardTransport& transport) const;
+    void sendOrDrain(int shard, int toEndpoint, const ShardMessage& msg, ShardTransport& transport,
+                     std::vector<std::shared_ptr<CellTower>>& towers,
+                     std::vector<ShardMessage>& towerStats, std::vector<bool>& doneFrom) const;
+    void handleWorkerMessage(const ShardMessage& msg, std::vector<std::shared_ptr<CellTower>>& towers,
+                             std::vector<ShardMessage>& towerStats, std::vector<bool>& doneFrom) const;
+public:
+    ShardCoordinator(const ShardedRunOptions& opts, const CellularNetworkSimulator& simulator,
+                     ResultWriter* writer);
+
+    // forks the workers, gathers their results and prints the summary
+    void run();
+};
+
+#endif // SHARDED_SIMULATION_H
@@ -0,0 +1,116 @@
+// StatsServer.cpp
+#include "StatsServer.h"
+#include "CellularNetwork.h"
+#include <cerrno>
+#include <cstring>
+#include <fcntl.h>
+#include <poll.h>
+#include <sys/socket.h>
+#include <sys/stat.h>
+#include <sys/un.h>
+#include <unistd.h>
+
+StatsSnapshot SimulationStats::snapshot() const {
+    StatsSnapshot snap;
+    snap.towersProcessed = towersProcessed.get();
+    snap.usersAdmitted = usersAdmitted.get();
+    snap.usersRejected = usersRejected.get();
+    snap.handoversRejected = handoversRejected.get();
+    snap.coreEstimate = coreEstimate.get();
+    snap.events = events.get();
+    snap.elapsedMicros = (long long)std::chrono::duration_cast<std::chrono::microseconds>(
+        std::chrono::steady_clock::now() - started).count();
+    snap.eventsPerSecond = snap.elapsedMicros > 0 ? (long long)((double)snap.events * 1e6 / snap.elapsedMicros) : 0;
+    return snap;
+}
+
+StatsServer::StatsServer(const char* socketPath, const SimulationStats& source)
+    : stats(source), path(socketPath ? socketPath : ""), listenFd(-1), wakePipe{-1, -1} {
+    sockaddr_un address;
+    std::memset(&address, 0, sizeof(address));
+    address.sun_family = AF_UNIX;
+    if (path.empty() || path.size() >= sizeof(address.sun_path)) {
+        throw InvalidConfigurationException("stats socket path is empty or too long");
+    }
+    std::memcpy(address.sun_path, path.c_str(), path.size() + 1);
+
+    listenFd = socket(AF_UNIX, SOCK_STREAM | SOCK_CLOEXEC, 0);
+    if (listenFd < 0) throw InvalidConfigurationException("cannot create stats socket");
+
+    // only ever replace a socket left behind by an earlier run: never a file,
+    // and never one a running process still accepts connections on
+    struct stat existing;
+    if (lstat(path.c_str(), &existing) == 0) {
+        if (!S_ISSOCK(existing.st_mode)) {
+            close(listenFd);
+            throw InvalidConfigurationException("stats socket path exists and is not a socket");
+        }
+        int probe = connect(listenFd, (const sockaddr*)&address, sizeof(address)) == 0 ? 0 : errno;
+        close(listenFd);
+        if (probe == ECONNREFUSED) unlink(path.c_str());
+        else if (probe != ENOENT) throw InvalidConfigurationException("stats socket already in use");
+        listenFd = socket(AF_UNIX, SOCK_STREAM | SOCK_CLOEXEC, 0);
+        if (listenFd < 0) throw InvalidConfigurationException("cannot create stats socket");
+    }
+
+    if (bind(listenFd, (const sockaddr*)&address, sizeof(address)) < 0 || listen(listenFd, 16) < 0) {
+        close(listenFd);
+        throw InvalidConfigurationException("cannot bind stats socket");
+    }
+    if (pipe2(wakePipe, O_CLOEXEC) < 0) {
+        close(listenFd);
+        unlink(path.c_str());
+        throw InvalidConfigurationException("cannot create stats server pipe");
+    }
+    server = std::thread(&StatsServer::serve, this);
+}
+
+StatsServer::~StatsServer() {
+    const char stop = 0;
+    while (write(wakePipe[1], &stop, 1) < 0 && errno == EINTR) {}
+    server.join();
+    close(wakePipe[0]);
+    close(wakePipe[1]);
+    close(listenFd);
+    unlink(path.c_str());
+}
+
+void StatsServer::serve() {
+    pollfd watched[2] = {{listenFd, POLLIN, 0}, {wakePipe[0], POLLIN, 0}};
+    for (;;) {
+        if (poll(watched, 2, -1) < 0) {
+            if (errno == EINTR) continue;
+            return;
+        }
+        if (watched[1].revents) return;
+        if (!(watched[0].revents & POLLIN)) continue;
+
+        int client = accept4(listenFd, nullptr, nullptr, SOCK_CLOEXEC);
+        if (client < 0) continue;
+        reply(client);
+        close(client);
+    }
+}
+
+// a snapshot is a few hundred bytes, well inside the socket buffer, so the
+// write never waits on the client
+void StatsServer::reply(int clientFd) const {
+    const StatsSnapshot snap = stats.snapshot();
+    std::string text;
+    text += "towers_processed " + std::to_string(snap.towersProcessed) + "\n";
+    text += "users_admitted " + std::to_string(snap.usersAdmitted) + "\n";
+    text += "users_rejected " + std::to_string(snap.usersRejected) + "\n";
+    text += "handovers_rejected " + std::to_string(snap.handoversRejected) + "\n";
+    text += "core_estimate " + std::to_string(snap.coreEstimate) + "\n";
+    text += "events " + std::to_string(snap.events) + "\n";
+    text += "events_per_second " + std::to_string(snap.eventsPerSecond) + "\n";
+    text += "uptime_ms " + std::to_string(snap.elapsedMicros / 1000) + "\n";
+
+    size_t sent = 0;
+    while (sent < text.size()) {
+        ssize_t n = send(clientFd, text.data() + sent, text.size() - sent, MSG_NOSIGNAL);
+        if (n < 0 && errno == EINTR) continue;
+        if (n <= 0) return;
+        sent += (size_t)n;
+    }
+}
@@ -0,0 +1,96 @@
+// StatsServer.h
+#ifndef STATS_SERVER_H
+#define STATS_SERVER_H
+
+#include <atomic>
+#include <chrono>
+#include <string>
+#include <thread>
+
+// ============================================================================
+// SIMULATION STATS
+// In-flight counters of a run, bumped by the simulation threads with relaxed
+// atomic adds and read without locks by the stats server. Each counter sits
+// on its own cache line so concurrent towers do not contend on one line.
+// ============================================================================
+struct StatsSnapshot {
+    long long towersProcessed;
+    long long usersAdmitted;
+    long long usersRejected;
+    long long handoversRejected;    // sharded mode: handed-over users the target tower refused
+    long long coreEstimate;         // cores needed by the towers processed so far
+    long long events;               // admission decisions (populated users + arrivals)
+    long long elapsedMicros;
+    long long eventsPerSecond;      // averaged since the run started
+};
+
+class SimulationStats {
+private:
+    struct alignas(64) Counter {
+        std::atomic<long long> value;
+        Counter() : value(0) {}
+        void add(long long delta) { value.fetch_add(delta, std::memory_order_relaxed); }
+        long long get() const { return value.load(std::memory_order_relaxed); }
+    };
+    Counter towersProcessed;
+    Counter usersAdmitted;
+    Counter usersRejected;
+    Counter handoversRejected;
+    Counter coreEstimate;
+    Counter events;
+    std::chrono::steady_clock::time_point started;
+
+public:
+    SimulationStats() : started(std::chrono::steady_clock::now()) {}
+
+    // users placed by populate(), reported as they are created
+    void recordPopulated(long long users) {
+        usersAdmitted.add(users);
+        events.add(users);
+    }
+    // an analysed tower (its users were reported by recordPopulated)
+    void recordTower(long long cores) {
+        towersProcessed.add(1);
+        coreEstimate.add(cores);
+    }
+    void recordAdmissions(long long admitted, long long rejected) {
+        usersAdmitted.add(admitted);
+        usersRejected.add(rejected);
+        events.add(admitted + rejected);
+    }
+    void recordHandoverRejections(long long rejected) { handoversRejected.add(rejected); }
+
+    StatsSnapshot snapshot() const;
+};
+
+// ============================================================================
+// STATS SERVER
+// Listens on a Unix domain stream socket and answers every connection with
+// one text snapshot of a SimulationStats ("name value" per line), then closes
+// it; e.g. `socat - UNIX-CONNECT:PATH`. A single background thread blocks in
+// poll(), so serving clients never touches the simulation threads.
+// ============================================================================
+class StatsServer {
+private:
+    const SimulationStats& stats;
+    std::string path;
+    int listenFd;
+    int wakePipe[2];   // written by the destructor to stop the thread
+    std::thread server;
+
+    void serve();
+    void reply(int clientFd) const;
+
+public:
+    // Binds path and starts serving. A socket already at path is replaced only
+    // when nothing accepts connections on it (left behind by an earlier run).
+    // Throws InvalidConfigurationException when the path is in use or the
+    // socket cannot be set up.
+    StatsServer(const char* socketPath, const SimulationStats& source);
+    ~StatsServer();
+
+    StatsServer(const StatsServer&) = delete;
+    StatsServer& operator=(const StatsServer&) = delete;
+};
+
+#endif // STATS_SERVER_H
@@ -0,0 +1,137 @@
+// TowerConfig.cpp
+#include "TowerConfig.h"
+#include <cerrno>
+#include <climits>
+#include <cstdlib>
+#include <cstring>
+#include <fcntl.h>
+#include <unistd.h>
+#include <string>
+#include <vector>
+
+static std::string readWholeFile(const char* path) {
+    int fd = open(path, O_RDONLY);
+    if (fd < 0) throw InvalidConfigurationException("cannot open tower config file");
+    std::string contents;
+    char chunk[4096];
+    long bytes;
+    while ((bytes = read(fd, chunk, sizeof(chunk))) > 0) contents.append(chunk, (size_t)bytes);
+    close(fd);
+    if (bytes < 0) throw InvalidConfigurationException("cannot read tower config file");
+    return contents;
+}
+
+static std::string trim(const std::string& text) {
+    size_t first = text.find_first_not_of(" \t\r");
+    if (first == std::string::npos) return "";
+    size_t last = text.find_last_not_of(" \t\r");
+    return text.substr(first, last - first + 1);
+}
+
+static GenerationType parseGeneration(const std::string& name) {
+    if (name == "2G" || name == "2g") return GEN_2G;
+    if (name == "3G" || name == "3g") return GEN_3G;
+    if (name == "4G" || name == "4g") return GEN_4G;
+    if (name == "5G" || name == "5g") return GEN_5G;
+    throw InvalidConfigurationException("unknown generation in tower config");
+}
+
+static int parseValue(const std::string& text) {
+    if (text.empty()) throw InvalidConfigurationException("missing value in tower config");
+    errno = 0;
+    char* end = nullptr;
+    long long value = std::strtoll(text.c_str(), &end, 10);
+    if (errno != 0 || *end != '\0' || value < 0 || value > INT_MAX) {
+        throw InvalidConfigurationException("invalid value in tower config");
+    }
+    return (int)value;
+}
+
+static int* settingField(TowerConfig& config, const std::string& key) {
+    if (key == "bandwidth_khz") return &config.totalBandwidth;
+    if (key == "channel_khz") return &config.channelBandwidth;
+    if (key == "users_per_channel") return &config.usersPerChannel;
+    if (key == "antennas") return &config.numAntennas;
+    if (key == "extra_bandwidth_khz") return &config.extraBandwidth;
+    if (key == "extra_channel_khz") return &config.extraChannelBandwidth;
+    if (key == "extra_users_per_channel") return &config.extraUsersPerChannel;
+    throw InvalidConfigurationException("unknown key in tower config");
+}
+
+void loadTowerConfigFile(const char* path, TowerConfig configs[4]) {
+    const std::string contents = readWholeFile(path);
+
+    // parse into a copy so a bad file leaves the caller's configs untouched
+    TowerConfig parsed[4] = {configs[0], configs[1], configs[2], configs[3]};
+
+    size_t lineStart = 0;
+    while (lineStart <= contents.size()) {
+        size_t lineEnd = contents.find('\n', lineStart);
+        if (lineEnd == std::string::npos) lineEnd = contents.size();
+        std::string line = contents.substr(lineStart, lineEnd - lineStart);
+        lineStart = lineEnd + 1;
+
+        size_t comment = line.find('#');
+        if (comment != std::string::npos) line.erase(comment);
+        line = trim(line);
+        if (line.empty()) continue;
+
+        size_t dot = line.find('.');
+        size_t equals = line.find('=');
+        if (dot == std::string::npos || equals == std::string::npos || dot > equals) {
+            throw InvalidConfigurationException("malformed line in tower config");
+        }
+        GenerationType gen = parseGeneration(trim(line.substr(0, dot)));
+        std::string key = trim(line.substr(dot + 1, equals - dot - 1));
+        *settingField(parsed[gen], key) = parseValue(trim(line.substr(equals + 1)));
+    }
+
+    for (int gen = 0; gen < 4; ++gen) parsed[gen].validate();
+    for (int gen = 0; gen < 4; ++gen) configs[gen] = parsed[gen];
+}
+
+// ============================================================================
+// Traffic settings
+// ============================================================================
+
+static TrafficClass parseTrafficClass(const std::string& name) {
+    for (int cls = 0; cls < TRAFFIC_CLASS_COUNT; ++cls) {
+        if (name == trafficClassName(static_cast<TrafficClass>(cls))) return static_cast<TrafficClass>(cls);
+    }
+    throw InvalidConfigurationException("unknown traffic class");
+}
+
+// splits text at every separator
+static std::vector<std::string> split(const std::string& text, char separator) {
+    std::vector<std::string> parts;
+    size_t start = 0;
+    while (true) {
+        size_t end = text.find(separator, start);
+        if (end == std::string::npos) {
+            parts.push_back(trim(text.substr(start)));
+            return parts;
+        }
+        parts.push_back(trim(text.substr(start, end - start)));
+        start = end + 1;
+    }
+}
+
+TrafficMix parseTrafficMix(const char* spec) {
+    TrafficMix mix = {{0, 0, 0, 0}};
+    for (const std::string& entry : split(spec, ',')) {
+        std::vector<std::string> fields = split(entry, ':');
+        if (fields.size() != 2) throw InvalidConfigurationException("traffic mix entries are class:percent");
+        mix.percent[parseTrafficClass(fields[0])] = parseValue(fields[1]);
+    }
+    mix.validate();
+    return mix;
+}
+
+void parseTrafficProfile(const char* spec, TrafficClass& cls, TrafficProfile& profile) {
+    std::vector<std::string> fields = split(spec, ':');
+    if (fields.size() != 3) throw InvalidConfigurationException("traffic profile is class:messages:overhead");
+    cls = parseTrafficClass(fields[0]);
+    profile.messages = parseValue(fields[1]);
+    profile.overheadPer100Messages = parseValue(fields[2]);
+    profile.validate();
+}
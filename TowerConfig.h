@@ -0,0 +1,34 @@
+// TowerConfig.h
+#ifndef TOWER_CONFIG_H
+#define TOWER_CONFIG_H
+
+#include "CellularNetwork.h"
+
+// ============================================================================
+// TOWER CONFIGURATION FILE
+// Plain-text overrides for the per-generation tower geometry, one setting per
+// line as "<generation>.<key> = <value>" ('#' starts a comment), e.g.
+//
+//     5G.bandwidth_khz = 100000       # 100 MHz carrier
+//     5G.users_per_channel = 3000
+//
+// Keys: bandwidth_khz, channel_khz, users_per_channel, antennas,
+//       extra_bandwidth_khz, extra_channel_khz, extra_users_per_channel
+//
+// Settings not mentioned keep their current value. Throws
+// InvalidConfigurationException on unreadable files, unknown keys or
+// values that do not describe a valid tower.
+// ============================================================================
+void loadTowerConfigFile(const char* path, TowerConfig configs[4]);
+
+// ============================================================================
+// TRAFFIC SETTINGS (command line)
+//   mix:     "data:60,voice:30,video:5,iot:5"   shares in percent, sum 100;
+//            classes left out get 0
+//   profile: "video:40:10"                      class:messages:overhead_per_100
+// Both throw InvalidConfigurationException on malformed input.
+// ============================================================================
+TrafficMix parseTrafficMix(const char* spec);
+void parseTrafficProfile(const char* spec, TrafficClass& cls, TrafficProfile& profile);
+
+#endif // TOWER_CONFIG_H
@@ -0,0 +1,110 @@
+// UserPlacement.cpp
+#include "UserPlacement.h"
+#include <cmath>
+#include <vector>
+
+// LTE CQI table (36.213 table 7.2.3-1): SNR needed for each level at 10% BLER
+// and the resource factor of that level against REFERENCE_CQI, per mille
+static const float CQI_SNR[UserPlacement::CQI_LEVELS] = {
+    0.2138f, 0.3388f, 0.5888f, 1.047f, 1.738f, 2.692f, 3.89f, 6.457f,
+    10.72f, 14.79f, 25.7f, 42.66f, 74.13f, 125.9f, 186.2f
+};
+static const uint32_t CQI_FACTOR_MILLI[UserPlacement::CQI_LEVELS] = {
+    9695, 6299, 3917, 2454, 1684, 1256, 1000, 771, 614, 541, 444, 378, 326, 289, 266
+};
+static const float EDGE_SNR = 0.3162f;     // -5 dB at one cell radius
+
+// hotspot model: share of users around the hotspots, their centres and spread
+static const int HOTSPOT_PERCENT = 70;
+static const int HOTSPOT_COUNT = 4;
+static const float HOTSPOT_X[HOTSPOT_COUNT] = {0.30f, -0.45f, -0.20f, 0.60f};
+static const float HOTSPOT_Y[HOTSPOT_COUNT] = {0.20f, 0.35f, -0.50f, -0.30f};
+static const float HOTSPOT_SIGMA = 0.08f;
+
+static const float TWO_PI = 6.2831853f;
+
+static inline uint64_t splitmix64(uint64_t value) {
+    value += 0x9E3779B97F4A7C15ULL;
+    value = (value ^ (value >> 30)) * 0xBF58476D1CE4E5B9ULL;
+    value = (value ^ (value >> 27)) * 0x94D049BB133111EBULL;
+    return value ^ (value >> 31);
+}
+
+// uniform in [0, 1) from 24 bits of a hash
+static inline float unitFloat(uint64_t bits) {
+    return (float)(bits & 0xFFFFFF) * (1.0f / 16777216.0f);
+}
+
+void UserPlacement::positions(PlacementModel model, uint64_t seed, const long long* ids, size_t count,
+                              float* x, float* y) {
+    for (size_t i = 0; i < count; ++i) {
+        const uint64_t h = splitmix64(seed ^ ((uint64_t)ids[i] * 0xD6E8FEB86659FD93ULL));
+        const float u = unitFloat(h);
+        const float v = unitFloat(h >> 24);
+
+        if (model == PLACEMENT_HOTSPOT && (int)((h >> 48) % 100) < HOTSPOT_PERCENT) {
+            // Box-Muller around the chosen hotspot, pulled back inside the cell
+            const int spot = (int)((h >> 56) % HOTSPOT_COUNT);
+            const float radius = HOTSPOT_SIGMA * std::sqrt(-2.0f * std::log(1.0f - u));
+            float px = HOTSPOT_X[spot] + radius * std::cos(TWO_PI * v);
+            float py = HOTSPOT_Y[spot] + radius * std::sin(TWO_PI * v);
+            const float d2 = px * px + py * py;
+            if (d2 > 1.0f) {
+                const float scale = 0.999f / std::sqrt(d2);
+                px *= scale;
+                py *= scale;
+            }
+            x[i] = px;
+            y[i] = py;
+        } else {
+            // uniform over the disk: radius sqrt(u) keeps the density flat
+            const float radius = std::sqrt(u);
+            x[i] = radius * std::cos(TWO_PI * v);
+            y[i] = radius * std::sin(TWO_PI * v);
+        }
+    }
+}
+
+uint64_t UserPlacement::resourceFactors(const float* x, const float* y, size_t count, uint32_t* factorMilli) {
+    // snr = EDGE_SNR / d^4 meets a level's threshold iff d^4 <= EDGE_SNR / threshold
+    float limit[CQI_LEVELS];
+    for (int level = 0; level < CQI_LEVELS; ++level) limit[level] = EDGE_SNR / CQI_SNR[level];
+
+    uint64_t total = 0;
+    for (size_t start = 0; start < count; start += BATCH) {
+        const size_t end = count - start < BATCH ? count : start + BATCH;
+        uint32_t sum = 0;   // a batch stays far below 2^32
+        for (size_t i = start; i < end; ++i) {
+            const float d2 = x[i] * x[i] + y[i] * y[i];
+            const float d4 = d2 * d2;
+            // below the first threshold users still get the lowest level
+            uint32_t factor = CQI_FACTOR_MILLI[0];
+            for (int level = 1; level < CQI_LEVELS; ++level) {
+                factor = d4 <= limit[level] ? CQI_FACTOR_MILLI[level] : factor;
+            }
+            factorMilli[i] = factor;
+            sum += factor;
+        }
+        total += sum;
+    }
+    return total;
+}
+
+uint64_t UserPlacement::factorSum(PlacementModel model, uint64_t seed, const long long* ids, size_t count) {
+    thread_local std::vector<float> x, y;
+    thread_local std::vector<uint32_t> factors;
+    const size_t batch = count < BATCH ? count : BATCH;
+    if (x.size() < batch) {
+        x.resize(batch);
+        y.resize(batch);
+        factors.resize(batch);
+    }
+
+    uint64_t total = 0;
+    for (size_t start = 0; start < count; start += BATCH) {
+        const size_t n = count - start < BATCH ? count - start : BATCH;
+        positions(model, seed, ids + start, n, x.data(), y.data());
+        total += resourceFactors(x.data(), y.data(), n, factors.data());
+    }
+    return total;
+}
@@ -0,0 +1,59 @@
+// UserPlacement.h
+#ifndef USER_PLACEMENT_H
+#define USER_PLACEMENT_H
+
+#include <cstddef>
+#include <cstdint>
+
+// ============================================================================
+// USER PLACEMENT - where users sit within a cell (selected with --placement)
+// ============================================================================
+enum PlacementModel {
+    PLACEMENT_NONE,       // every user gets the same capacity (project spec)
+    PLACEMENT_UNIFORM,    // uniform over the cell disk
+    PLACEMENT_HOTSPOT,    // most users clustered around a few hotspots
+    PLACEMENT_MODEL_COUNT
+};
+
+inline const char* placementModelName(PlacementModel model) {
+    switch (model) {
+        case PLACEMENT_NONE: return "none";
+        case PLACEMENT_UNIFORM: return "uniform";
+        case PLACEMENT_HOTSPOT: return "hotspot";
+        default: break;
+    }
+    return "unknown";
+}
+
+// ============================================================================
+// USER PLACEMENT AND LINK MODEL
+// A user's position is a pure function of its device ID (hashed with the
+// seed), so eager, lazy and parallel population all agree on it without
+// storing coordinates. Positions are in cell radii around the tower.
+//
+// The link model turns coordinates into the radio resources a user needs:
+// SNR falls off with distance^4 (-5 dB at the cell edge), the SNR picks the
+// highest LTE CQI whose threshold it meets, and the resource factor is the
+// reference CQI's spectral efficiency over the user's. The user counts of
+// the project spec assume every user at the reference CQI (factor 1.000);
+// cell-centre users need less, cell-edge users up to ~9.7x as much.
+// ============================================================================
+class UserPlacement {
+public:
+    static const int CQI_LEVELS = 15;
+    static const int REFERENCE_CQI = 7;        // 16QAM, 1.4766 bit/s/Hz
+    static const size_t BATCH = 4096;          // users per kernel call in sums
+
+    // cell-radius coordinates of each ID
+    static void positions(PlacementModel model, uint64_t seed, const long long* ids, size_t count,
+                          float* x, float* y);
+
+    // Per-user resource factors in per mille of a reference-CQI user; returns
+    // their sum. Branch-free over plain arrays so the compiler vectorises it.
+    static uint64_t resourceFactors(const float* x, const float* y, size_t count, uint32_t* factorMilli);
+
+    // positions + resourceFactors for a batch of IDs (any count; uses scratch)
+    static uint64_t factorSum(PlacementModel model, uint64_t seed, const long long* ids, size_t count);
+};
+
+#endif // USER_PLACEMENT_H
@@ -12,14 +12,63 @@ extern "C" long syscall3(long number, long arg1, long arg2, long arg3);
 
 static char inputBuffer[256];
 
+// per-thread redirection target (null: talk to the real file descriptors)
+static thread_local IOCapture* activeCapture = nullptr;
+
+static void writeOut(int fd, const char* data, long len) {
+    if (len <= 0) return;
+    if (activeCapture) {
+        auto& segments = activeCapture->segments;
+        if (segments.empty() || segments.back().first != fd) segments.emplace_back(fd, std::string());
+        segments.back().second.append(data, (size_t)len);
+        return;
+    }
+    syscall3(SYS_WRITE, fd, (long)data, len);
+}
+
+// next scripted line into buffer (at most size-1 chars); false when not capturing
+static bool readScripted(char* buffer, int size) {
+    if (!activeCapture) return false;
+    buffer[0] = '\0';
+    if (activeCapture->nextInput >= activeCapture->inputLines.size()) return true;
+    const std::string& line = activeCapture->inputLines[activeCapture->nextInput++];
+    int i = 0;
+    for (; i < size - 1 && i < (int)line.size(); ++i) buffer[i] = line[i];
+    buffer[i] = '\0';
+    return true;
+}
+
+// decimal text of number into buffer (no terminator), returns length
+static int formatInt(long long number, char* out) {
+    char buffer[32];
+    int i = 0;
+    // work on the magnitude as unsigned so LLONG_MIN does not overflow
+    unsigned long long magnitude = number < 0 ? 0ULL - (unsigned long long)number
+                                              : (unsigned long long)number;
+    do {
+        buffer[i++] = '0' + (magnitude % 10);
+        magnitude /= 10;
+    } while (magnitude > 0);
+    if (number < 0) buffer[i++] = '-';
+
+    for (int j = 0; j < i; ++j) out[j] = buffer[i - 1 - j];
+    return i;
+}
+
 void basicIO::activateInput() {
     for (int i = 0; i < 256; ++i) inputBuffer[i] = 0;
 }
 
 int basicIO::inputint() {
     char buffer[32] = {0};
-    long bytes = syscall3(SYS_READ, STDIN, (long)buffer, 31);
-    if (bytes <= 0) return 0;
+    long bytes;
+    if (readScripted(buffer, 31)) {
+        bytes = 0;
+        while (buffer[bytes]) ++bytes;
+    } else {
+        bytes = syscall3(SYS_READ, STDIN, (long)buffer, 31);
+        if (bytes <= 0) return 0;
+    }
     if (bytes > 30) bytes = 30;
     buffer[bytes] = '\0';
     int result = 0;
@@ -41,6 +90,7 @@ int basicIO::inputint() {
 }
 
 const char* basicIO::inputstring() {
+    if (readScripted(inputBuffer, 256)) return inputBuffer;
     long bytes = syscall3(SYS_READ, STDIN, (long)inputBuffer, 255);
     if (bytes <= 0) {
         inputBuffer[0] = '\0';
@@ -56,6 +106,7 @@ const char* basicIO::inputstring() {
 
 void basicIO::inputstring(char* buffer, int size) {
     if (!buffer || size <= 0) return;
+    if (readScripted(buffer, size)) return;
     char ch;
     int i = 0;
     while (i < size - 1) {
@@ -67,72 +118,53 @@ void basicIO::inputstring(char* buffer, int size) {
 }
 
 void basicIO::outputint(int number) {
-    char buffer[32];
-    int i = 0;
-    bool isNegative = false;
-    if (number == 0) {
-        buffer[i++] = '0';
-    } else {
-        if (number < 0) {
-            isNegative = true;
-            number = -number;
-        }
-
-        while (number > 0) {
-            buffer[i++] = '0' + (number % 10);
-            number /= 10;
-        }
-
-        if (isNegative) {
-            buffer[i++] = '-';
-        }
-    }
+    outputlong(number);
+}
 
-    for (int j = i - 1; j >= 0; --j) {
-        syscall3(SYS_WRITE, STDOUT, (long)&buffer[j], 1);
-    }
+void basicIO::outputlong(long long number) {
+    char out[32];
+    writeOut(STDOUT, out, formatInt(number, out));
 }
 
 void basicIO::outputstring(const char* text) {
     long len = 0;
     while (text[len]) ++len;
-    if (len > 0) syscall3(SYS_WRITE, STDOUT, (long)text, len);
+    writeOut(STDOUT, text, len);
 }
 
 void basicIO::terminate() {
     char newline = '\n';
-    syscall3(SYS_WRITE, STDOUT, (long)&newline, 1);
+    writeOut(STDOUT, &newline, 1);
 }
 
 void basicIO::errorstring(const char* text) {
     long len = 0;
     while (text[len]) ++len;
-    if (len > 0) syscall3(SYS_WRITE, STDERR, (long)text, len);
+    writeOut(STDERR, text, len);
 }
 
 void basicIO::errorint(int number) {
-    char buffer[32];
-    int i = 0;
-    bool isNegative = false;
-    if (number == 0) {
-        buffer[i++] = '0';
-    } else {
-        if (number < 0) {
-            isNegative = true;
-            number = -number;
-        }
+    char out[32];
+    writeOut(STDERR, out, formatInt(number, out));
+}
 
-        while (number > 0) {
-            buffer[i++] = '0' + (number % 10);
-            number /= 10;
-        }
+void basicIO::beginCapture(IOCapture* capture) {
+    activeCapture = capture;
+}
 
-        if (isNegative) {
-            buffer[i++] = '-';
-        }
-    }
+void basicIO::endCapture() {
+    activeCapture = nullptr;
+}
 
-    for (int j = i - 1; j >= 0; --j) {
-        syscall3(SYS_WRITE, STDERR, (long)&buffer[j], 1);
+void basicIO::replay(const IOCapture& capture) {
+    for (const auto& segment : capture.segments) {
+        const std::string& text = segment.second;
+        size_t offset = 0;
+        while (offset < text.size()) {
+            long written = syscall3(SYS_WRITE, segment.first, (long)(text.data() + offset),
+                                    (long)(text.size() - offset));
+            if (written <= 0) break;
+            offset += (size_t)written;
+        }
     }
 }
@@ -1,6 +1,18 @@
 #ifndef BASIC_IO_H
 #define BASIC_IO_H
 
+#include <string>
+#include <utility>
+#include <vector>
+
+// Output captured by one thread instead of being written, plus the input lines
+// that thread reads back in place of stdin (see basicIO::beginCapture).
+struct IOCapture {
+    std::vector<std::pair<int, std::string>> segments;  // (fd, text) in write order
+    std::vector<std::string> inputLines;                // scripted input, consumed in order
+    size_t nextInput = 0;
+};
+
 class basicIO {
 public:
     void activateInput();
@@ -8,10 +20,17 @@ public:
     const char* inputstring();
     void inputstring(char* buffer, int size);
     void outputint(int value);
+    void outputlong(long long value);
     void outputstring(const char* text);
     void terminate();
     void errorstring(const char* text);
     void errorint(int number);
+
+    // Redirects the calling thread's I/O into capture until endCapture().
+    void beginCapture(IOCapture* capture);
+    void endCapture();
+    // Writes captured output to the real stdout/stderr in its original order.
+    void replay(const IOCapture& capture);
 };
 
 extern basicIO io;
@@ -1,5 +1,12 @@
 // main.cpp
 #include "CellularNetwork.h"
+#include "ResultWriter.h"
+#include "MultiRatSite.h"
+#include "OccupancyRecorder.h"
+#include "ScenarioCache.h"
+#include "ShardedSimulation.h"
+#include "StatsServer.h"
+#include "TowerConfig.h"
 #include "basicIO.h"
 #include <cstdlib>
 #include <fcntl.h>
@@ -7,6 +14,7 @@
 #include <errno.h>
 #include <cstring>
 #include <iostream>
+#include <vector>
 
 extern basicIO io;
 
@@ -50,18 +58,330 @@ static bool redirectStdinToFile(const char* path) {
     return true;
 }
 
+// Gives stdout to the structured results: returns a new descriptor for the
+// original stdout and points fd 1 at stderr, so the menu, prompts and report
+// cannot interleave with the records. Returns -1 (after printing why) on failure.
+static int takeStdoutForResults() {
+    int fd = dup(STDOUT_FILENO);
+    if (fd < 0 || dup2(STDERR_FILENO, STDOUT_FILENO) < 0) {
+        std::cerr << "Error: cannot move report output to stderr: " << strerror(errno) << std::endl;
+        if (fd >= 0) close(fd);
+        return -1;
+    }
+    return fd;
+}
+
+// Command line: [options] [input-file]
+struct CommandLineOptions {
+    const char* inputFile = nullptr;
+    ResultFormat resultFormat = RESULT_NONE;
+    const char* resultFile = nullptr;
+    bool resultUserRows = false;
+    int saturatedCells = 0;
+    int saturationPercent = 0;
+    const char* towerConfigFile = nullptr;
+    bool lazyPopulation = false;
+    bool parallelAll = false;
+    bool sharded = false;
+    ShardedRunOptions shardOptions;
+    bool latencyReport = false;
+    bool corePacking = false;
+    CoreGranularity packingGranularity = PACK_PER_CHANNEL;
+    bool scenarioCache = false;
+    const char* cacheFile = nullptr;
+    const char* trafficMix = nullptr;
+    std::vector<const char*> trafficProfiles;
+    long long overloadArrivals = 0;
+    const char* statsSocket = nullptr;
+    PlacementModel placement = PLACEMENT_NONE;
+    bool multiRat = false;
+    MultiRatOptions multiRatOptions;
+    const char* recordFile = nullptr;
+    const char* recordReadFile = nullptr;
+    long long recordFromTick = 0;
+    long long recordToTick = -1;            // -1: to the last recorded tick
+};
+
+static bool startsWith(const char* text, const char* prefix) {
+    return std::strncmp(text, prefix, std::strlen(prefix)) == 0;
+}
+
+// Returns false (after printing the reason to stderr) on an unknown or malformed option.
+static bool parseCommandLine(int argc, char** argv, CommandLineOptions& opts) {
+    for (int i = 1; i < argc; ++i) {
+        const char* arg = argv[i];
+        if (std::strcmp(arg, "--results=csv") == 0) {
+            opts.resultFormat = RESULT_CSV;
+        } else if (std::strcmp(arg, "--results=json") == 0) {
+            opts.resultFormat = RESULT_JSON;
+        } else if (startsWith(arg, "--results-file=")) {
+            opts.resultFile = arg + std::strlen("--results-file=");
+        } else if (std::strcmp(arg, "--results-users") == 0) {
+            opts.resultUserRows = true;
+        } else if (startsWith(arg, "--results-saturated=")) {
+            char* end = nullptr;
+            opts.saturatedCells = (int)strtol(arg + std::strlen("--results-saturated="), &end, 10);
+            if (*end == ':') opts.saturationPercent = (int)strtol(end + 1, &end, 10);
+            if (*end != '\0' || opts.saturatedCells <= 0 || opts.saturationPercent < 0 ||
+                opts.saturationPercent > 100) {
+                std::cerr << "Error: --results-saturated needs K or K:PERCENT" << std::endl;
+                return false;
+            }
+        } else if (startsWith(arg, "--tower-config=")) {
+            opts.towerConfigFile = arg + std::strlen("--tower-config=");
+        } else if (std::strcmp(arg, "--parallel-all") == 0) {
+            opts.parallelAll = true;
+        } else if (std::strcmp(arg, "--lazy") == 0) {
+            opts.lazyPopulation = true;
+        } else if (startsWith(arg, "--shards=")) {
+            opts.sharded = true;
+            opts.shardOptions.numShards = atoi(arg + std::strlen("--shards="));
+        } else if (startsWith(arg, "--shard-towers=")) {
+            opts.shardOptions.towersPerGeneration = atoi(arg + std::strlen("--shard-towers="));
+        } else if (startsWith(arg, "--shard-load=")) {
+            opts.shardOptions.loadPercent = atoi(arg + std::strlen("--shard-load="));
+        } else if (startsWith(arg, "--shard-handover=")) {
+            opts.shardOptions.handoverPercent = atoi(arg + std::strlen("--shard-handover="));
+        } else if (std::strcmp(arg, "--multi-rat") == 0) {
+            opts.multiRat = true;
+        } else if (startsWith(arg, "--multi-rat=")) {
+            opts.multiRat = true;
+            opts.multiRatOptions.arrivalsPerTick = atoll(arg + std::strlen("--multi-rat="));
+        } else if (startsWith(arg, "--multi-rat-ticks=")) {
+            opts.multiRatOptions.ticks = atoi(arg + std::strlen("--multi-rat-ticks="));
+        } else if (startsWith(arg, "--record=")) {
+            opts.recordFile = arg + std::strlen("--record=");
+        } else if (startsWith(arg, "--record-read=")) {
+            opts.recordReadFile = arg + std::strlen("--record-read=");
+        } else if (startsWith(arg, "--record-ticks=")) {
+            char* end = nullptr;
+            opts.recordFromTick = strtoll(arg + std::strlen("--record-ticks="), &end, 10);
+            if (*end != '-' || opts.recordFromTick < 0) {
+                std::cerr << "Error: --record-ticks needs FROM-TO" << std::endl;
+                return false;
+            }
+            opts.recordToTick = strtoll(end + 1, &end, 10);
+            if (*end != '\0' || opts.recordToTick < opts.recordFromTick) {
+                std::cerr << "Error: --record-ticks needs FROM-TO" << std::endl;
+                return false;
+            }
+        } else if (std::strcmp(arg, "--cache") == 0) {
+            opts.scenarioCache = true;
+        } else if (startsWith(arg, "--cache=")) {
+            opts.scenarioCache = true;
+            opts.cacheFile = arg + std::strlen("--cache=");
+        } else if (std::strcmp(arg, "--core-packing=channel") == 0) {
+            opts.corePacking = true;
+            opts.packingGranularity = PACK_PER_CHANNEL;
+        } else if (std::strcmp(arg, "--core-packing=antenna") == 0) {
+            opts.corePacking = true;
+            opts.packingGranularity = PACK_PER_ANTENNA;
+        } else if (startsWith(arg, "--overload=")) {
+            opts.overloadArrivals = atoll(arg + std::strlen("--overload="));
+            if (opts.overloadArrivals <= 0) {
+                std::cerr << "Error: --overload needs a positive number of arrivals" << std::endl;
+                return false;
+            }
+        } else if (std::strcmp(arg, "--placement=uniform") == 0) {
+            opts.placement = PLACEMENT_UNIFORM;
+        } else if (std::strcmp(arg, "--placement=hotspot") == 0) {
+            opts.placement = PLACEMENT_HOTSPOT;
+        } else if (startsWith(arg, "--stats-socket=")) {
+            opts.statsSocket = arg + std::strlen("--stats-socket=");
+        } else if (std::strcmp(arg, "--latency") == 0) {
+            opts.latencyReport = true;
+        } else if (startsWith(arg, "--traffic-mix=")) {
+            opts.trafficMix = arg + std::strlen("--traffic-mix=");
+        } else if (startsWith(arg, "--traffic-profile=")) {
+            opts.trafficProfiles.push_back(arg + std::strlen("--traffic-profile="));
+        } else if (startsWith(arg, "--")) {
+            std::cerr << "Error: unknown option \"" << arg << "\"" << std::endl;
+            return false;
+        } else if (!opts.inputFile) {
+            opts.inputFile = arg;
+        } else {
+            std::cerr << "Error: more than one input file given" << std::endl;
+            return false;
+        }
+    }
+    if ((opts.resultFile || opts.resultUserRows || opts.saturatedCells > 0) && opts.resultFormat == RESULT_NONE) {
+        std::cerr << "Error: --results-file/--results-users/--results-saturated need --results=csv|json"
+                  << std::endl;
+        return false;
+    }
+    if (opts.recordFile && !opts.multiRat) {
+        std::cerr << "Error: --record needs --multi-rat" << std::endl;
+        return false;
+    }
+    return true;
+}
+
+// prints one line per recorded tower: ticks in range, users summed over its
+// cells at the busiest tick, the mean over the range and the busiest cell
+static void summariseOccupancyRecord(const char* path, long long fromTick, long long toTick) {
+    OccupancyRecordReader reader(path);
+    const std::vector<RecordedTower>& towers = reader.getTowers();
+    struct TowerSummary {
+        long long ticks = 0;
+        long long totalUsers = 0;
+        long long peakUsers = -1;
+        long long peakTick = 0;
+        int busiestCell = 0;
+    };
+    std::vector<TowerSummary> summary(towers.size());
+    if (toTick < 0) toTick = (1LL << 62);
+    reader.read(fromTick, toTick, [&](int tower, long long tick, const int32_t* cells) {
+        TowerSummary& s = summary[(size_t)tower];
+        long long users = 0;
+        const size_t count = towers[(size_t)tower].cells();
+        for (size_t cell = 0; cell < count; ++cell) {
+            users += cells[cell];
+            if (cells[cell] > s.busiestCell) s.busiestCell = cells[cell];
+        }
+        ++s.ticks;
+        s.totalUsers += users;
+        if (users > s.peakUsers) {
+            s.peakUsers = users;
+            s.peakTick = tick;
+        }
+    });
+
+    io.outputstring("\n========== OCCUPANCY RECORD ==========");
+    io.terminate();
+    for (size_t tower = 0; tower < towers.size(); ++tower) {
+        const RecordedTower& info = towers[tower];
+        const TowerSummary& s = summary[tower];
+        io.outputstring(info.label.c_str());
+        io.outputstring(" (");
+        io.outputint(info.bands);
+        io.outputstring("x");
+        io.outputint(info.antennas);
+        io.outputstring("x");
+        io.outputint(info.channels);
+        io.outputstring(" cells): ");
+        io.outputlong(s.ticks);
+        io.outputstring(" ticks");
+        if (s.ticks > 0) {
+            io.outputstring(", peak ");
+            io.outputlong(s.peakUsers);
+            io.outputstring(" users at tick ");
+            io.outputlong(s.peakTick);
+            io.outputstring(", mean ");
+            io.outputlong(s.totalUsers / s.ticks);
+            io.outputstring(", busiest cell ");
+            io.outputint(s.busiestCell);
+        }
+        io.terminate();
+    }
+}
+
 int main(int argc, char** argv) {
     try {
-        // If filename provided as first argument, redirect stdin to it.
+        CommandLineOptions opts;
+        if (!parseCommandLine(argc, argv, opts)) return 1;
+
+        // reading back a recording needs no simulator at all
+        if (opts.recordReadFile) {
+            summariseOccupancyRecord(opts.recordReadFile, opts.recordFromTick, opts.recordToTick);
+            return 0;
+        }
+
+        // If an input file is provided, redirect stdin to it.
         // This makes all existing calls that read from STDIN (via basicIO/syscall) work unchanged.
-        if (argc > 1) {
-            if (!redirectStdinToFile(argv[1])) {
+        if (opts.inputFile) {
+            if (!redirectStdinToFile(opts.inputFile)) {
                 std::cerr << "Falling back to interactive stdin is not attempted; exiting." << std::endl;
                 return 1;
             }
         }
 
+        // structured results go to --results-file, or take over stdout
+        int resultFd = STDOUT_FILENO;
+        if (opts.resultFile) {
+            resultFd = ResultWriter::openOutputFile(opts.resultFile);
+        } else if (opts.resultFormat != RESULT_NONE) {
+            resultFd = takeStdoutForResults();
+            if (resultFd < 0) return 1;
+        }
+        ResultWriter results(opts.resultFormat, resultFd);
+
         CellularNetworkSimulator simulator;
+        simulator.setResultWriter(&results, opts.resultUserRows);
+        simulator.setSaturatedCellReport(opts.saturatedCells, opts.saturationPercent);
+        simulator.setLazyPopulation(opts.lazyPopulation);
+        simulator.setParallelAll(opts.parallelAll);
+        simulator.setLatencyReport(opts.latencyReport);
+        simulator.setCorePacking(opts.corePacking, opts.packingGranularity);
+        simulator.setOverloadArrivals(opts.overloadArrivals);
+        simulator.setPlacement(opts.placement);
+
+        SimulationStats stats;
+        std::unique_ptr<StatsServer> statsServer;
+        if (opts.statsSocket) {
+            statsServer.reset(new StatsServer(opts.statsSocket, stats));
+            simulator.setStats(&stats);
+        }
+
+        std::unique_ptr<ScenarioCache> cache;
+        if (opts.scenarioCache) {
+            cache.reset(new ScenarioCache());
+            if (opts.cacheFile) cache->openDiskStore(opts.cacheFile);
+            simulator.setScenarioCache(cache.get());
+        }
+
+        if (opts.towerConfigFile) {
+            TowerConfig configs[4] = {simulator.getTowerConfig(GEN_2G), simulator.getTowerConfig(GEN_3G),
+                                      simulator.getTowerConfig(GEN_4G), simulator.getTowerConfig(GEN_5G)};
+            loadTowerConfigFile(opts.towerConfigFile, configs);
+            for (int gen = GEN_2G; gen <= GEN_5G; ++gen) {
+                simulator.setTowerConfig(static_cast<GenerationType>(gen), configs[gen]);
+            }
+        }
+        if (opts.trafficMix) simulator.setTrafficMix(parseTrafficMix(opts.trafficMix));
+        for (const char* spec : opts.trafficProfiles) {
+            TrafficClass cls;
+            TrafficProfile profile;
+            parseTrafficProfile(spec, cls, profile);
+            simulator.setTrafficProfile(cls, profile);
+        }
+
+        // sharded mode is non-interactive: run it and exit instead of showing the menu
+        if (opts.sharded) {
+            ShardCoordinator coordinator(opts.shardOptions, simulator, &results);
+            coordinator.run();
+            return 0;
+        }
+        // so is the multi-RAT steering study
+        if (opts.multiRat) {
+            MultiRatStudy study(opts.multiRatOptions, simulator, &results);
+            std::unique_ptr<OccupancyRecorder> recorder;
+            if (opts.recordFile) {
+                recorder.reset(new OccupancyRecorder(opts.recordFile));
+                study.setRecorder(recorder.get());
+            }
+            study.run();
+            if (recorder) {
+                recorder->close();
+                // raw is the int32 cube per tick that the recording replaces
+                const long long rawBytes = recorder->getCellsRecorded() * (long long)sizeof(int32_t);
+                const long long tenths = rawBytes > 0 ? recorder->getBytesWritten() * 1000 / rawBytes : 0;
+                io.outputstring("Recorded ");
+                io.outputlong(recorder->getTicksRecorded());
+                io.outputstring(" tower ticks, ");
+                io.outputlong(recorder->getCellsRecorded());
+                io.outputstring(" cell samples, to ");
+                io.outputstring(opts.recordFile);
+                io.outputstring(" (");
+                io.outputlong(recorder->getBytesWritten());
+                io.outputstring(" bytes, ");
+                io.outputlong(tenths / 10);
+                io.outputstring(".");
+                io.outputlong(tenths % 10);
+                io.outputstring("% of raw)");
+                io.terminate();
+            }
+            return 0;
+        }
         bool running = true;
         printHeader();
 
@@ -91,12 +411,9 @@ int main(int argc, char** argv) {
                     simulator.simulate5G();
                     break;
                 case 5:
-                    // simulate all sequentially (these will consume further lines from the input file
+                    // simulate all (these will consume further lines from the input file
                     // for any interactive prompts inside each simulation)
-                    simulator.simulate2G();
-                    simulator.simulate3G();
-                    simulator.simulate4G();
-                    simulator.simulate5G();
+                    simulator.simulateAll();
                     break;
                 case 0:
                     io.outputstring("\nExiting. Goodbye!\n");
@@ -109,6 +426,15 @@ int main(int argc, char** argv) {
             }
         }
 
+        if (cache) {
+            io.errorstring("Scenario cache: ");
+            io.errorint((int)(cache->getMemoryHits() + cache->getDiskHits()));
+            io.errorstring(" hits (");
+            io.errorint((int)cache->getDiskHits());
+            io.errorstring(" from disk), ");
+            io.errorint((int)cache->getMisses());
+            io.errorstring(" misses\n");
+        }
         return 0;
 
     } catch (const NetworkException& e) {